@@ -0,0 +1,75 @@
+#version 430
+
+const int VOXELS_WIDTH=512;
+const int VOXELS_HEIGHT=96;
+const uint BRICK_SIZE=8;
+const uint BRICK_VOXELS=BRICK_SIZE*BRICK_SIZE*BRICK_SIZE;
+const uint BRICK_RLE=1;
+const uint GROUP_SIZE=64;
+
+layout(local_size_x=64) in;
+
+#if VOXEL_TEXTURE
+//level 0 of the voxel texture, see VOXEL_TEXTURE in render.hpp
+layout(r32i, binding=0) writeonly uniform iimage3D voxelImage;
+#else
+layout(std430, binding=2) writeonly buffer voxelBuffer{
+	int voxels[];
+};
+#endif
+
+layout(std430, binding=3) readonly buffer brickBuffer{
+	uvec2 bricks[];
+};
+
+layout(std430, binding=4) readonly buffer streamBuffer{
+	uint stream[];
+};
+
+//palette index of every voxel in this brick
+shared uint brickIndices[BRICK_VOXELS];
+
+void main(){
+	uvec3 brick=gl_WorkGroupID;
+	uint brickIndex=brick.x + gl_NumWorkGroups.x * (brick.y + gl_NumWorkGroups.y * brick.z);
+	
+	//header is the palette offset and paletteSize | bits << 16 | mode << 24
+	uint paletteOffset=bricks[brickIndex].x;
+	uint info=bricks[brickIndex].y;
+	uint bits=(info >> 16) & 0xFFu;
+	uint payload=paletteOffset + (info & 0xFFFFu);
+	
+	if ((info >> 24) == BRICK_RLE){
+		//every thread walks the runs together and fills its share of each one
+		uint runStart=0;
+		for (uint run=payload; runStart < BRICK_VOXELS; run++){
+			uint runEnd=runStart + (stream[run] >> 16);
+			
+			for (uint i=runStart + gl_LocalInvocationIndex; i < runEnd; i+=GROUP_SIZE){
+				brickIndices[i]=stream[run] & 0xFFFFu;
+			}
+			runStart=runEnd;
+		}
+	}
+	else{
+		for (uint i=gl_LocalInvocationIndex; i < BRICK_VOXELS; i+=GROUP_SIZE){
+			uint bitOffset=i * bits;
+			
+			//uniform bricks have no payload at all
+			brickIndices[i]=bits == 0 ? 0 : (stream[payload + bitOffset / 32] >> (bitOffset % 32)) & ((1u << bits) - 1);
+		}
+	}
+	barrier();
+	
+	//threads are laid out along x and y so rows of the brick are written together
+	for (uint i=gl_LocalInvocationIndex; i < BRICK_VOXELS; i+=GROUP_SIZE){
+		uvec3 pos=brick * BRICK_SIZE + uvec3(i % BRICK_SIZE, (i / BRICK_SIZE) % BRICK_SIZE, i / (BRICK_SIZE * BRICK_SIZE));
+		
+#if VOXEL_TEXTURE
+		imageStore(voxelImage, ivec3(pos), ivec4(stream[paletteOffset + brickIndices[i]]));
+#else
+		uint index=pos.x + VOXELS_WIDTH * pos.y + VOXELS_WIDTH * VOXELS_HEIGHT * pos.z;
+		voxels[index]=int(stream[paletteOffset + brickIndices[i]]);
+#endif
+	}
+}
@@ -0,0 +1,55 @@
+layout(rgba8, binding=0) writeonly uniform image2D frame;
+
+//G-buffer written by gbuffer.glsl, hit position and distance then voxel index and normal
+layout(rgba32f, binding=2) uniform image2D gPosition;
+layout(rg32i, binding=3) uniform iimage2D gVoxel;
+
+//lighting traced or reprojected by shadow.glsl for one pixel out of every shadowScale x shadowScale,
+//hit position then lighting multiplier so next frame can check the history still matches
+layout(rgba32f, binding=4) uniform image2D shadowLight;
+layout(rgba32f, binding=5) readonly uniform image2D shadowHistory;
+
+//shadow pixels trace fresh lighting once every HISTORY_FRAMES frames
+const int HISTORY_FRAMES=4;
+
+//normals are always axis aligned so only the axis and its sign are stored
+int encodeNormal(vec3 normal){
+	if (normal.x != 0){
+		return normal.x > 0 ? 0 : 1;
+	}
+	else if (normal.y != 0){
+		return normal.y > 0 ? 2 : 3;
+	}
+	return normal.z > 0 ? 4 : 5;
+}
+
+vec3 decodeNormal(int code){
+	vec3 normal=vec3(0, 0, 0);
+	normal[code / 2]=(code & 1) == 0 ? 1.0f : -1.0f;
+	return normal;
+}
+
+bool onScreen(ivec2 pixel){
+	return pixel.x < int(screenSize.x) && pixel.y < int(screenSize.y);
+}
+
+ivec2 getShadowSize(){
+	return (ivec2(screenSize) + shadowScale - 1) / shadowScale;
+}
+
+//the full resolution pixel whose hit a low resolution lighting sample was traced from
+ivec2 getShadowSamplePixel(ivec2 shadowPixel){
+	return min(shadowPixel * shadowScale + shadowScale / 2, ivec2(screenSize) - 1);
+}
+
+//pixel a world position was seen at last frame, inverse of getRayDirection with the previous camera
+vec2 getPrevPixel(vec3 pos){
+	vec3 view=vec3(transpose(prevRotateMatrix) * vec4(pos - prevCamPos, 0));
+	
+	//behind the previous camera
+	if (view.z <= 0.0f){
+		return vec2(-1, -1);
+	}
+	vec2 screenPos=vec2(view.x / (view.z*aspectRatio), view.y / view.z);
+	return (screenPos + 1.0f) * 0.5f * screenSize - 0.5f;
+}
@@ -0,0 +1,28 @@
+#version 430
+
+#include "raycast.glsl"
+#include "deferred.glsl"
+
+layout(local_size_x=8, local_size_y=8) in;
+
+void main(){
+	ivec2 pixel=ivec2(gl_GlobalInvocationID.xy);
+	
+	if (!onScreen(pixel)){
+		return;
+	}
+	
+	int fColorIndex=castPrimaryRay(pixel);
+	
+#if DEPTH_VIEW
+	imageStore(frame, pixel, depthFieldColor());
+#endif
+	
+	//only keep hits with a color, everything else is sky
+	if (fColorIndex != -1 && readVoxel(fColorIndex) < 0){
+		fColorIndex=-1;
+	}
+	
+	imageStore(gPosition, pixel, vec4(hitPos, length(hitPos - camPos)));
+	imageStore(gVoxel, pixel, ivec4(fColorIndex, encodeNormal(hitNormal), 0, 0));
+}
@@ -0,0 +1,34 @@
+#version 430
+
+#include "raycast.glsl"
+#include "deferred.glsl"
+
+in vec3 worldPos;
+flat in int normalCode;
+flat in ivec3 minCell;
+flat in ivec3 maxCell;
+
+//the same G-buffer gbuffer.glsl writes as images, attached to the hybrid path's framebuffer
+layout(location=0) out vec4 gPositionOut;
+layout(location=1) out ivec4 gVoxelOut;
+
+void main(){
+	float dist=length(worldPos - camPos);
+	
+	//primary rays stop at the render distance
+	if (dist > renderDist){
+		discard;
+	}
+	
+	//the voxel behind this pixel, kept on the quad where the interpolated position lands on its edge
+	ivec3 cell=clamp(ivec3(floor(worldPos - decodeNormal(normalCode) * 0.5f)), minCell, maxCell);
+	int index=getVoxelIndex(cell);
+	
+	//chunks an edit emptied draw their old mesh until the rebuild is uploaded
+	if (readVoxel(index) < 0){
+		discard;
+	}
+	
+	gPositionOut=vec4(worldPos, dist);
+	gVoxelOut=ivec4(index, normalCode, 0, 0);
+}
@@ -0,0 +1,25 @@
+#version 430
+
+//quad corner and the voxels its quad covers, packed by mesh.cpp
+layout(location=0) in uint corner;
+layout(location=1) in uvec2 cells;
+
+//the primary ray projection, see getViewProjection in mesh.cpp
+layout(location=0) uniform mat4 viewProjection;
+
+out vec3 worldPos;
+flat out int normalCode;
+flat out ivec3 minCell;
+flat out ivec3 maxCell;
+
+ivec3 unpackCell(uint bits){
+	return ivec3(bits & 0x3FFu, (bits >> 10) & 0x7Fu, (bits >> 17) & 0x3FFu);
+}
+
+void main(){
+	worldPos=vec3(unpackCell(corner));
+	normalCode=int(corner >> 27);
+	minCell=unpackCell(cells.x);
+	maxCell=unpackCell(cells.y);
+	gl_Position=viewProjection * vec4(worldPos, 1);
+}
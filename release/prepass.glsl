@@ -0,0 +1,56 @@
+#version 430
+
+#include "raycast.glsl"
+
+const int MAX_PREPASS_STEPS=128;
+
+//one thread per 8x8 pixel tile
+layout(local_size_x=8, local_size_y=8) in;
+
+vec3 getPixelRayDirection(vec2 pixel){
+	return getRayDirection(getScreenPos(pixel));
+}
+
+void main(){
+	ivec2 tile=ivec2(gl_GlobalInvocationID.xy);
+	
+	if (tile.x * TILE_SIZE >= int(screenSize.x) || tile.y * TILE_SIZE >= int(screenSize.y)){
+		return;
+	}
+	
+	//the cone around the center ray has to hold the rays of every pixel in the tile
+	vec2 pixelMin=vec2(tile * TILE_SIZE);
+	vec2 pixelMax=min(pixelMin + TILE_SIZE - 1, screenSize - 1);
+	vec3 centerDir=getPixelRayDirection((pixelMin + pixelMax) * 0.5f);
+	
+	float cosAngle=1.0f;
+	cosAngle=min(cosAngle, dot(centerDir, getPixelRayDirection(pixelMin)));
+	cosAngle=min(cosAngle, dot(centerDir, getPixelRayDirection(pixelMax)));
+	cosAngle=min(cosAngle, dot(centerDir, getPixelRayDirection(vec2(pixelMin.x, pixelMax.y))));
+	cosAngle=min(cosAngle, dot(centerDir, getPixelRayDirection(vec2(pixelMax.x, pixelMin.y))));
+	float coneSlope=sqrt(1.0f - cosAngle*cosAngle) / cosAngle;
+	
+	//march the cone using the depth field as the free distance around each point
+	float dist=0.0f;
+	for (int i=0; i<MAX_PREPASS_STEPS && dist < renderDist; i++){
+		ivec3 voxel=ivec3(floor(camPos + centerDir*dist));
+		int index=getVoxelIndex(voxel);
+		
+		//stop at solid voxels, voxels next to them and the edge of the map
+		if (index < 0 || readVoxel(voxel, 0, index) >= EMPTY_LIGHT_MIN){
+			break;
+		}
+		
+		//furthest point where the whole cone is still inside the free sphere
+		float freeDist=-intBitsToFloat(readVoxel(voxel, 0, index));
+		float nextDist=(dist + freeDist) / (1.0f + coneSlope);
+		
+		if (nextDist < dist + 0.01f){
+			break;
+		}
+		dist=nextDist;
+	}
+	
+	//back off a voxel so rays start in the empty cell before their hit
+	imageStore(startDepth, tile, vec4(max(0.0f, min(dist, float(renderDist)) - 1.0f)));
+}
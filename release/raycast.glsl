@@ -0,0 +1,632 @@
+const int VOXELS_WIDTH=512;
+const int VOXELS_HEIGHT=96;
+const int RENDER_DIST=384;
+const int MAX_LOCAL_LIGHTS=4096;
+const int LOCAL_LIGHT_DIST=64;
+const int LIGHT_CELL_SIZE=64;
+const ivec3 LIGHT_GRID=ivec3(VOXELS_WIDTH, VOXELS_HEIGHT + LIGHT_CELL_SIZE - 1, VOXELS_WIDTH) / LIGHT_CELL_SIZE;
+const int LIGHT_CELLS=LIGHT_GRID.x * LIGHT_GRID.y * LIGHT_GRID.z;
+const int LIGHTS_PER_CELL=256;
+const int LIGHT_VOLUME_WIDTH=LOCAL_LIGHT_DIST * 2;
+const int LIGHT_VOLUME_WORDS=LIGHT_VOLUME_WIDTH * VOXELS_HEIGHT * LIGHT_VOLUME_WIDTH / 32;
+const int TILE_SIZE=8;
+const int VOXEL_COUNT=VOXELS_WIDTH * VOXELS_HEIGHT * VOXELS_WIDTH;
+const int LOD_LEVELS=3;
+const int LOD_START=64;
+const int PROBE_SPACING=8;
+const ivec3 PROBE_GRID=ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) / PROBE_SPACING;
+const int PROBE_COUNT=PROBE_GRID.x * PROBE_GRID.y * PROBE_GRID.z;
+const int HEIGHT_TILE_SIZE=16;
+const int HEIGHT_TILES=VOXELS_WIDTH / HEIGHT_TILE_SIZE;
+const int EMPTY_LIGHT_MIN=-256;
+const float BLOCK_LIGHT_SCALE=128.0f;
+const float AMBIENT=0.4f;
+const float OCCLUSION_STRENGTH=0.7f;
+const float DIFFUSE=0.8f;
+const float MAX_OVERBRIGHT=1.25f;
+const vec4 SKY_COLOR=vec4(0.6, 0.7, 0.8, 1);
+
+//lights ranked per hit when a cell has more than maxLights, see rankStrongestLights
+const int RANKED_LIGHTS=16;
+
+#if VOXEL_TEXTURE
+//voxels with each downsampled level as a mip level, see VOXEL_TEXTURE in render.hpp
+layout(binding=1) uniform isampler3D voxelTexture;
+#else
+//full resolution voxels followed by each downsampled level, see lod.cpp
+layout(std430, binding=2) buffer voxelBuffer{
+	int voxels[];
+};
+#endif
+
+//one bit per voxel, set when an empty voxel next to a surface sees the sun, written by sunmap.glsl
+layout(std430, binding=1) buffer sunBuffer{
+	uint sunVisibility[];
+};
+
+//tallest solid voxel anywhere and per 16x16 tile of columns, -1 when empty, see heightmap.cpp
+layout(std430, binding=0) readonly buffer heightBuffer{
+	int maxHeight;
+	int tileHeights[HEIGHT_TILES * HEIGHT_TILES];
+};
+
+//4 bits per voxel of how boxed in each empty voxel is, see occlusion.cpp
+layout(std430, binding=8) readonly buffer occlusionBuffer{
+	uint occlusion[];
+};
+
+//ambient scale from sky and bounce light seen around each probe, -1 when buried, written by probes.glsl
+layout(std430, binding=9) buffer probeBuffer{
+	float probes[PROBE_COUNT];
+};
+
+//local lights and the world space grid bucketing them, see lights.cpp
+layout(std430, binding=5) readonly buffer lightBuffer{
+	vec4 localLights[MAX_LOCAL_LIGHTS];
+	int lightVolumes[MAX_LOCAL_LIGHTS];
+};
+
+layout(std430, binding=6) readonly buffer lightGridBuffer{
+	int cellLightCounts[LIGHT_CELLS];
+	int cellLights[LIGHT_CELLS * LIGHTS_PER_CELL];
+};
+
+//cached shadows of static lights, one bit per voxel of the box around the light, see computeLightVolume in lights.cpp
+layout(std430, binding=7) readonly buffer lightVolumeBuffer{
+	uint lightVolumeBits[];
+};
+
+//per frame data shared by every program, see frameUniforms in render.cpp
+//render settings are not in here, they are compiled in as DEPTH_VIEW, BLOCK_LIGHT and the other SHADER_* flags of render.hpp
+layout(std140, binding=0) uniform frameBuffer{
+	mat4 rotateMatrix;
+	vec3 camPos;
+	float aspectRatio;
+	vec3 lightPos;
+	int shadowScale;
+	vec2 camRotation;
+	vec2 screenSize;
+	int frameIndex;
+	int historyValid;
+	int sunMapReady;
+	mat4 prevRotateMatrix;
+	vec3 prevCamPos;
+	
+	//quality knobs lowered by the governor when frames run over, see governor.cpp
+	int renderDist;
+	int lightDist;
+	int maxLights;
+	int shadowDist;
+};
+
+//safe distance to start primary rays from, one texel per tile written by prepass.glsl
+layout(r32f, binding=1) uniform image2D startDepth;
+
+vec3 hitPos=vec3(0,0,0);
+vec3 hitNormal=vec3(0,0,0);
+
+float stepCount=0.0f;
+
+//rays switch to downsampled voxels far from the camera, off for rays that fill in per voxel data
+bool lodRays=true;
+
+int getVoxelIndex(ivec3 currCheck){
+	int hit=-1;
+	
+	//convert our vector into a 3D array index
+	currCheck.y*=VOXELS_WIDTH;
+	currCheck.z*=VOXELS_WIDTH * VOXELS_HEIGHT;
+	int index=currCheck.x+currCheck.y+currCheck.z;
+	
+	//check if the index is within array bounds
+	if (index < VOXELS_WIDTH*VOXELS_HEIGHT*VOXELS_WIDTH &&
+		currCheck.z >= 0 && currCheck.z < VOXELS_WIDTH*VOXELS_HEIGHT*VOXELS_WIDTH &&
+		currCheck.y >= 0 && currCheck.y < VOXELS_WIDTH*VOXELS_HEIGHT &&
+		currCheck.x >= 0 && currCheck.x < VOXELS_WIDTH){
+		
+		//hit voxel
+		hit=index;
+	}
+	
+	return hit;
+}
+
+//value of a cell of a level, index is its getLodIndex
+int readVoxel(ivec3 cell, int level, int index){
+#if VOXEL_TEXTURE
+	return texelFetch(voxelTexture, cell, level).r;
+#else
+	return voxels[index];
+#endif
+}
+
+//value at an index from getVoxelIndex or castRay
+int readVoxel(int index){
+#if VOXEL_TEXTURE
+	ivec3 size=ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH);
+	int level=0;
+	
+	//levels follow each other in index order
+	while (index >= size.x * size.y * size.z){
+		index-=size.x * size.y * size.z;
+		size>>=1;
+		level++;
+	}
+	return texelFetch(voxelTexture, ivec3(index % size.x, (index / size.x) % size.y, index / (size.x * size.y)), level).r;
+#else
+	return voxels[index];
+#endif
+}
+
+ivec3 vec3ToIntVec3(vec3 oldVec){
+	ivec3 newVec=ivec3(int(oldVec.x), int(oldVec.y), int(oldVec.z));
+	return newVec;
+}
+
+//index of a cell of a downsampled level, -1 off the map
+int getLodIndex(ivec3 cell, int level){
+	ivec3 size=ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) >> level;
+	
+	if (any(lessThan(cell, ivec3(0, 0, 0))) || any(greaterThanEqual(cell, size))){
+		return -1;
+	}
+	//levels follow the voxels, each an eighth the size of the one before
+	int offset=level == 0 ? 0 : VOXEL_COUNT + (VOXEL_COUNT - (VOXEL_COUNT >> (3*level - 3))) / 7;
+	return offset + cell.x + size.x * (cell.y + size.y * cell.z);
+}
+
+//LOD distances count from the camera, views.glsl defines this as the view it is tracing
+#ifndef LOD_ORIGIN
+#define LOD_ORIGIN camPos
+#endif
+
+//each level doubles the distance from the camera it starts at, a ray must also be clear of the cell it started in,
+//nextCheck is how far along the ray the level could change next
+
+int getLodLevel(vec3 pos, float rayDist, out float nextCheck){
+	float camDist=distance(pos, LOD_ORIGIN);
+	int level=0;
+	
+	while (lodRays && level < LOD_LEVELS && camDist >= (LOD_START << level) && rayDist >= (4 << level)){
+		level++;
+	}
+	nextCheck=lodRays && level < LOD_LEVELS ? rayDist + max((LOD_START << level) - camDist, (4 << level) - rayDist) : RENDER_DIST * 2;
+	return level;
+}
+
+//how far a ray at pos in an empty voxel can skip while staying above every column of its height tile
+float heightJump(ivec3 voxel, vec3 pos, vec3 rayDirection){
+	ivec2 tile=voxel.xz / HEIGHT_TILE_SIZE;
+	int tileHeight=tileHeights[tile.x + HEIGHT_TILES*tile.y];
+	
+	if (voxel.y <= tileHeight){
+		return 0.0f;
+	}
+	
+	//leave through the side of the tile or come down onto its tallest column
+	vec2 tileStart=vec2(tile*HEIGHT_TILE_SIZE);
+	float toExit=RENDER_DIST;
+	if (rayDirection.x != 0.0f){
+		toExit=min(toExit, (tileStart.x + (rayDirection.x > 0.0f ? HEIGHT_TILE_SIZE : 0) - pos.x) / rayDirection.x);
+	}
+	if (rayDirection.z != 0.0f){
+		toExit=min(toExit, (tileStart.y + (rayDirection.z > 0.0f ? HEIGHT_TILE_SIZE : 0) - pos.z) / rayDirection.z);
+	}
+	if (rayDirection.y < 0.0f){
+		toExit=min(toExit, (tileHeight + 1 - pos.y) / rayDirection.y);
+	}
+	
+	//stop just short so the first voxel past the tile is still tested
+	return toExit > 1.0f ? toExit - 0.01f : 0.0f;
+}
+
+//a hit on a downsampled cell moves to the nearest full resolution surface inside the cell facing the ray,
+//each column of the cell along the normal is walked in from the hit face to its first solid voxel,
+//so lookups of the empty voxel in front of a hit land on a surface, the hit stays put if the cell has none
+vec3 findCellSurface(vec3 pos, vec3 normal, int level){
+	int size=1 << level;
+	int axis=normal.x != 0.0f ? 0 : (normal.y != 0.0f ? 1 : 2);
+	ivec3 inward=-ivec3(normal);
+	ivec3 across=axis == 0 ? ivec3(0, 1, 0) : ivec3(1, 0, 0);
+	ivec3 down=axis == 2 ? ivec3(0, 1, 0) : ivec3(0, 0, 1);
+	
+	//the layer of the cell the ray came in through
+	ivec3 front=ivec3(floor((pos - normal*0.5f) / size)) * size;
+	if (normal[axis] > 0.0f){
+		front[axis]+=size - 1;
+	}
+	
+	vec3 surface=pos;
+	float nearest=RENDER_DIST;
+	for (int a=0; a<size; a++){
+		for (int b=0; b<size; b++){
+			for (int depth=0; depth<size; depth++){
+				ivec3 voxel=front + across*a + down*b + inward*depth;
+				int index=getVoxelIndex(voxel);
+				
+				if (index >= 0 && readVoxel(index) >= 0){
+					vec3 facePos=clamp(pos, vec3(voxel), vec3(voxel) + 1.0f);
+					facePos[axis]=voxel[axis] + (normal[axis] > 0.0f ? 1 : 0);
+					
+					if (length(facePos - pos) < nearest){
+						nearest=length(facePos - pos);
+						surface=facePos;
+					}
+					break;
+				}
+			}
+		}
+	}
+	return surface;
+}
+
+//whether the voxel behind a hit is solid, coarse hits with no surface found in their cell aren't,
+//and the lookups of the empty voxel in front would read empty space
+bool onSurface(vec3 pos, vec3 normal){
+	int index=getVoxelIndex(ivec3(floor(pos - normal*0.5f)));
+	return index >= 0 && readVoxel(index) >= 0;
+}
+
+int castRay(vec3 startPosition, vec3 rayDirection, int dist){ //NOTE: rayDirection should be normalized
+	//record which axis rays have hit a plane
+	bvec3 axisHit=bvec3(false, false, false);
+	
+	//clip the ray to the world's bounding box, rays from outside start where they enter and rays that miss it never step
+	vec3 worldNear=(vec3(0, 0, 0) - startPosition) / (rayDirection + 0.000001f);
+	vec3 worldFar=(vec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) - startPosition) / (rayDirection + 0.000001f);
+	vec3 enterDists=min(worldNear, worldFar);
+	float enterDist=max(max(enterDists.x, enterDists.y), enterDists.z);
+	vec3 exitDists=max(worldNear, worldFar);
+	float exitDist=min(min(exitDists.x, exitDists.y), exitDists.z);
+	
+	if (exitDist < max(enterDist, 0.0f) || enterDist >= dist){
+		return -1;
+	}
+	if (enterDist > 0.0f){
+		startPosition+=rayDirection*enterDist;
+		dist-=int(enterDist);
+		
+		//the face the ray came in through, in case the voxel it enters is solid
+		hitNormal=vec3(0, 0, 0);
+		int enterAxis=enterDist == enterDists.x ? 0 : enterDist == enterDists.y ? 1 : 2;
+		hitNormal[enterAxis]=-sign(rayDirection[enterAxis]);
+	}
+	
+	//storage for ray steps
+	ivec3 currCheck=clamp(vec3ToIntVec3(startPosition), ivec3(0, 0, 0), ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) - 1);
+	
+	//color index of the ray
+	int fColorIndex=-1;
+	int tempIndex=-1;
+	
+	//calculate the step intervals each axis takes
+	ivec3 step=vec3ToIntVec3(vec3(sign(rayDirection.x), sign(rayDirection.y), sign(rayDirection.z)));
+	ivec3 forwardSteps=ivec3(int(step.x > 0), int(step.y > 0), int(step.z > 0));
+	
+	float dx=1.0f/abs(rayDirection.x + 0.000001f);
+	float dy=1.0f/abs(rayDirection.y + 0.000001f);
+	float dz=1.0f/abs(rayDirection.z + 0.000001f);
+	
+	//find the first intersect of each axis
+	vec3 intersect=(currCheck + forwardSteps - startPosition) / rayDirection;
+	
+	float currDist=0.0f;
+	float distTravelled=0.0f;
+	float anchorDist=max(enterDist, 0.0f);
+	float lodCheck=0.0f;
+	int level=0;
+	float cellSize=1.0f;
+	bool stepRay=enterDist <= 0.0f;
+	while (distTravelled < dist && distTravelled < RENDER_DIST){
+		stepCount++;
+		distTravelled+=cellSize;
+		//a coarse cell the ray just landed in is tested before stepping out of it
+		if (!stepRay){
+			stepRay=true;
+		}
+		//check which axis has the shortest intersect
+		else if (intersect.x < intersect.y && intersect.x < intersect.z){
+			currDist=intersect.x;
+			currCheck.x+=step.x;
+			intersect.x+=dx;
+			hitNormal=vec3(-step.x, 0, 0);
+		}
+		else if (intersect.y < intersect.x && intersect.y < intersect.z){
+			currDist=intersect.y;
+			currCheck.y+=step.y;
+			intersect.y+=dy;
+			hitNormal=vec3(0, -step.y, 0);
+		}
+		else{
+			currDist=intersect.z;
+			currCheck.z+=step.z;
+			intersect.z+=dz;
+			hitNormal=vec3(0, 0, -step.z);
+		}
+		tempIndex=getLodIndex(currCheck, level);
+		int voxel=tempIndex >= 0 ? readVoxel(currCheck, level, tempIndex) : -1;
+		
+		//ray hit
+		if (voxel >= 0){
+			hitPos=rayDirection*currDist + startPosition;
+			fColorIndex=tempIndex;
+			break;
+		}
+		//out of bounds
+		else if (tempIndex < 0){
+			break;
+		}
+		//above the tallest column and rising, only sky is left
+		else if (rayDirection.y >= 0.0f && (currCheck.y << level) > maxHeight){
+			break;
+		}
+		
+		//skip over the height tile or by the depth field, whichever is further
+		float toJump=heightJump(currCheck << level, rayDirection*currDist + startPosition, rayDirection);
+		if (level == 0 && voxel < EMPTY_LIGHT_MIN){
+			toJump=max(toJump, -intBitsToFloat(voxel));
+		}
+		int nextLevel=level;
+		if (anchorDist + currDist + toJump >= lodCheck){
+			nextLevel=max(level, getLodLevel(rayDirection*(currDist + toJump) + startPosition, anchorDist + currDist + toJump, lodCheck));
+		}
+		
+		//restart the traversal from where the ray jumped to, on a coarser level once it is far enough from the camera
+		if (toJump > 0.0f || nextLevel > level){
+			distTravelled+=toJump;
+			currDist+=toJump;
+			startPosition=rayDirection*currDist + startPosition;
+			anchorDist+=currDist;
+			level=nextLevel;
+			cellSize=float(1 << level);
+			currCheck=vec3ToIntVec3(startPosition / cellSize);
+			intersect=((currCheck + forwardSteps) * cellSize - startPosition) / rayDirection;
+			dx=cellSize/abs(rayDirection.x + 0.000001f);
+			dy=cellSize/abs(rayDirection.y + 0.000001f);
+			dz=cellSize/abs(rayDirection.z + 0.000001f);
+			currDist=0.0f;
+			stepRay=level == 0;
+		}
+	}
+	
+	if (level > 0 && fColorIndex != -1){
+		hitPos=findCellSurface(hitPos, hitNormal, level);
+	}
+	return fColorIndex;
+}
+
+//direction of the primary ray through a point on the screen, both axes in [-1, 1]
+vec3 getRayDirection(vec2 screenPos){
+	vec3 rayDirection=normalize(vec3(screenPos.x*aspectRatio, screenPos.y, 1.0f));
+	return vec3(rotateMatrix * vec4(rayDirection, 0));
+}
+
+//screen position of a pixel center, the same points the fragment path gets from the fullscreen quad
+vec2 getScreenPos(vec2 pixel){
+	return (pixel + 0.5f) / screenSize * 2.0f - 1.0f;
+}
+
+//primary rays skip the empty space the depth prepass found in front of their tile
+int castPrimaryRay(ivec2 pixel){
+	vec3 rayDirection=getRayDirection(getScreenPos(pixel));
+	float startDist=0.0f;
+	
+#if DEPTH_PREPASS
+	startDist=imageLoad(startDepth, pixel / TILE_SIZE).r;
+#endif
+	return castRay(camPos + rayDirection*startDist, rayDirection, renderDist - int(startDist));
+}
+
+//look up the empty voxel in front of the hit once the sun map has been swept, before that cast a shadow ray,
+//traced rays stop at the governed shadowDist while the swept map keeps full length shadows
+bool sunVisible(vec3 pos, vec3 normal, vec3 toLight){
+#if NO_SHADOWS
+	return true;
+#endif
+	int index=getVoxelIndex(ivec3(floor(pos + normal*0.5f)));
+	
+	if (sunMapReady == 1 && index >= 0 && onSurface(pos, normal)){
+		return (sunVisibility[index / 32] & (1u << (index % 32))) != 0;
+	}
+	return castRay(pos + toLight*0.001f, toLight, shadowDist) == -1;
+}
+
+float sunLight(vec3 pos, vec3 normal){
+	vec3 toLight=normalize(lightPos - pos);
+	
+	if (sunVisible(pos, normal, toLight)){
+		return DIFFUSE*max(0, dot(normal, toLight));
+	}
+	return 0.0f;
+}
+
+//static lights look up whether the empty voxel in front of the hit sees them, others cast a ray
+bool localLightVisible(int lightIndex, vec3 pos, vec3 normal, vec3 toLocalLight, float localLightDist){
+#if NO_SHADOWS
+	return true;
+#endif
+	int volume=lightVolumes[lightIndex];
+	
+	if (volume >= 0 && onSurface(pos, normal)){
+		vec3 light=localLights[lightIndex].xyz;
+		ivec3 voxel=ivec3(floor(pos + normal*0.5f)) - ivec3(int(floor(light.x)) - LOCAL_LIGHT_DIST, 0, int(floor(light.z)) - LOCAL_LIGHT_DIST);
+		
+		if (all(greaterThanEqual(voxel, ivec3(0, 0, 0))) && all(lessThan(voxel, ivec3(LIGHT_VOLUME_WIDTH, VOXELS_HEIGHT, LIGHT_VOLUME_WIDTH)))){
+			int bit=voxel.x + LIGHT_VOLUME_WIDTH * (voxel.y + VOXELS_HEIGHT * voxel.z);
+			return (lightVolumeBits[volume*LIGHT_VOLUME_WORDS + bit / 32] & (1u << (bit % 32))) != 0;
+		}
+	}
+	return castRay(pos + toLocalLight*0.001f, toLocalLight, int(localLightDist+1)) == -1;
+}
+
+//unshadowed contribution of a local light, what localLight returns when nothing blocks the ray
+float localLightTarget(int light, vec3 pos, vec3 normal){
+	vec4 localLight=localLights[light];
+	float localLightDist=length(localLight.xyz - pos);
+	
+	if (localLight.x < 0 || localLight.y < 0 || localLight.z < 0 || localLightDist > lightDist){
+		return 0.0f;
+	}
+	return localLight.a * max(0, dot(normal, normalize(localLight.xyz - pos))) * ((lightDist - localLightDist) / lightDist);
+}
+
+float localLight(int lightIndex, vec3 pos, vec3 normal){
+	vec4 light=localLights[lightIndex];
+	
+	//ensure local light is in scene
+	if (light.x >= 0 && light.y >= 0 && light.z >= 0){
+		float localLightDist=length(light.xyz - pos);
+		
+		//make sure local light isnt too far away
+		if (localLightDist <= lightDist){
+			//cast ray to local light
+			vec3 toLocalLight=normalize(light.xyz - pos);
+			
+			if (localLightVisible(lightIndex, pos, normal, toLocalLight, localLightDist)){
+				//use normal and add light decay for local lights, fading out at the governor's reach
+				return light.a * max(0, dot(normal, toLocalLight)) * ((lightDist - localLightDist) / lightDist);
+			}
+		}
+	}
+	return 0.0f;
+}
+
+//trilinear blend of the 8 probes around the front of a hit, skipping buried ones
+float probeLight(vec3 pos, vec3 normal){
+	vec3 probePos=(pos + normal*0.5f) / PROBE_SPACING - 0.5f;
+	ivec3 base=ivec3(floor(probePos));
+	vec3 blend=probePos - base;
+	float light=0.0f;
+	float weights=0.0f;
+	
+	for (int i=0; i<8; i++){
+		ivec3 offset=ivec3(i & 1, (i >> 1) & 1, i >> 2);
+		ivec3 cell=clamp(base + offset, ivec3(0, 0, 0), PROBE_GRID - 1);
+		float probe=probes[cell.x + PROBE_GRID.x * (cell.y + PROBE_GRID.y * cell.z)];
+		vec3 weight=mix(1.0f - blend, blend, vec3(offset));
+		
+		if (probe >= 0.0f){
+			light+=probe * weight.x * weight.y * weight.z;
+			weights+=weight.x * weight.y * weight.z;
+		}
+	}
+	return weights > 0.0f ? light / weights : 1.0f;
+}
+
+//ambient light of a hit, scaled by the probes and darkened by the solid voxels around the empty voxel in front of it
+float ambientLight(vec3 pos, vec3 normal){
+	int index=getVoxelIndex(ivec3(floor(pos + normal*0.5f)));
+	
+	if (index < 0){
+		return AMBIENT;
+	}
+	uint level=(occlusion[index / 8] >> ((index % 8) * 4)) & 15u;
+	return AMBIENT * probeLight(pos, normal) * (1.0f - OCCLUSION_STRENGTH * float(level) / 15.0f);
+}
+
+//light grid cell a position is in, every light that can reach the position is in its bucket
+int getLightCell(vec3 pos){
+	ivec3 cell=clamp(ivec3(floor(pos / LIGHT_CELL_SIZE)), ivec3(0, 0, 0), LIGHT_GRID - 1);
+	return cell.x + LIGHT_GRID.x * (cell.y + LIGHT_GRID.y * cell.z);
+}
+
+//flood filled local light of the empty voxel in front of a hit, see blocklight.cpp
+float blockLightLevel(vec3 pos, vec3 normal){
+	int index=getVoxelIndex(ivec3(floor(pos + normal*0.5f)));
+	
+	int voxel=index >= 0 ? readVoxel(index) : 0;
+	
+	if (voxel < 0 && voxel >= EMPTY_LIGHT_MIN){
+		return float(-1 - voxel) / BLOCK_LIGHT_SCALE;
+	}
+	return 0.0f;
+}
+
+//cell slots of the lights with the strongest unshadowed contribution at a hit, strongest first,
+//ranked in one pass over the cell without casting any rays
+int rankStrongestLights(int cell, vec3 pos, vec3 normal, out int slots[RANKED_LIGHTS]){
+	int count=cellLightCounts[cell];
+	int size=min(maxLights, RANKED_LIGHTS);
+	float targets[RANKED_LIGHTS];
+	int ranked=0;
+	
+	for (int i=0; i<count; i++){
+		float target=localLightTarget(cellLights[cell*LIGHTS_PER_CELL + i], pos, normal);
+		
+		//lights adding nothing are never ranked, a full list drops its weakest
+		if (target > 0.0f && (ranked < size || target > targets[size - 1])){
+			int j=min(ranked, size - 1);
+			
+			for (; j>0 && targets[j - 1] < target; j--){
+				targets[j]=targets[j - 1];
+				slots[j]=slots[j - 1];
+			}
+			targets[j]=target;
+			slots[j]=i;
+			ranked=min(ranked + 1, size);
+		}
+	}
+	return ranked;
+}
+
+//full lighting multiplier of a hit, the sun plus every local light in range
+float lightHit(vec3 pos, vec3 normal){
+	float multiplier=ambientLight(pos, normal) + sunLight(pos, normal);
+	
+	//no local light rays in block light mode
+#if BLOCK_LIGHT
+	return min(multiplier + blockLightLevel(pos, normal), MAX_OVERBRIGHT);
+#else
+	int cell=getLightCell(pos);
+	int count=cellLightCounts[cell];
+	
+	int traced=0;
+	uint rankedBits[LIGHTS_PER_CELL / 32];
+	
+	for (int i=0; i<LIGHTS_PER_CELL / 32; i++){
+		rankedBits[i]=0u;
+	}
+	
+	//when the governor caps the rays, the lights contributing most at this hit are traced first,
+	//a list that isn't full already holds every light adding anything, otherwise the rest of the budget goes in cell order
+	if (count > maxLights){
+		int slots[RANKED_LIGHTS];
+		int ranked=rankStrongestLights(cell, pos, normal, slots);
+		
+		for (int i=0; i<ranked && multiplier<MAX_OVERBRIGHT; i++){
+			rankedBits[slots[i] / 32]|=1u << (slots[i] % 32);
+			multiplier+=localLight(cellLights[cell*LIGHTS_PER_CELL + slots[i]], pos, normal);
+		}
+		traced=ranked < RANKED_LIGHTS ? maxLights : ranked;
+	}
+	
+	//cast rays to the local lights of this cell
+	for (int i=0; i<count && traced<maxLights; i++){
+		//ensure we don't make areas overbright
+		if (multiplier >= MAX_OVERBRIGHT){
+			multiplier=MAX_OVERBRIGHT;
+			break;
+		}
+		if ((rankedBits[i / 32] & (1u << (i % 32))) == 0u){
+			multiplier+=localLight(cellLights[cell*LIGHTS_PER_CELL + i], pos, normal);
+			traced++;
+		}
+	}
+	//the last light in the bucket can still push it over
+	return min(multiplier, MAX_OVERBRIGHT);
+#endif
+}
+
+vec4 voxelColor(int voxel, float multiplier){
+	//color of voxels is stored in a single int to save memory, we use bitwise ops to extract RGB values
+	vec4 color;
+	color.r=float((voxel & 0x00FF0000) >> 16) / 255.0f * multiplier;
+	color.g=float((voxel & 0x0000FF00) >> 8) / 255.0f * multiplier;
+	color.b=float(voxel & 0x000000FF) / 255.0f * multiplier;
+	color.a=1.0f;
+	return color;
+}
+
+vec4 depthFieldColor(){
+	return vec4(stepCount/100, stepCount/100, stepCount/100, 1);
+}
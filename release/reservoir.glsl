@@ -0,0 +1,71 @@
+//weighted reservoirs picking one local light per shadow pixel, resampled from the cell's bucket
+//and reused from last frame, the light index, its contribution weight and how many candidates it stands for
+layout(rgba32f, binding=6) uniform image2D reservoirs;
+layout(rgba32f, binding=7) readonly uniform image2D reservoirHistory;
+
+//random bucket lights tried per pixel per frame
+const int LIGHT_CANDIDATES=8;
+
+//history is capped so old samples can't drown out new ones
+const float MAX_HISTORY_CANDIDATES=20.0f * LIGHT_CANDIDATES;
+
+//share of a new stochastic lighting sample in the accumulated lighting
+const float STOCHASTIC_BLEND=0.2f;
+
+struct reservoir{
+	int light;
+	float weightSum;
+	float candidates;
+	float weight;
+};
+
+uint randomState;
+
+//pcg hash
+uint hashRandom(uint state){
+	state=state * 747796405u + 2891336453u;
+	uint word=((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+float random(){
+	randomState=hashRandom(randomState);
+	return float(randomState) / 4294967296.0f;
+}
+
+void updateReservoir(inout reservoir r, int light, float weight, float candidates){
+	r.weightSum+=weight;
+	r.candidates+=candidates;
+	
+	if (random() * r.weightSum < weight){
+		r.light=light;
+	}
+}
+
+//merge a reservoir from last frame, its light is weighed again at this pixel
+void mergeReservoir(inout reservoir r, vec4 history, vec3 pos, vec3 normal){
+	int light=floatBitsToInt(history.x);
+	
+	if (light >= 0){
+		float candidates=min(history.z, MAX_HISTORY_CANDIDATES);
+		updateReservoir(r, light, localLightTarget(light, pos, normal) * history.y * candidates, candidates);
+	}
+}
+
+void finishReservoir(inout reservoir r, vec3 pos, vec3 normal){
+	float target=r.light >= 0 ? localLightTarget(r.light, pos, normal) : 0.0f;
+	r.weight=target > 0.0f ? r.weightSum / (r.candidates * target) : 0.0f;
+}
+
+//pick candidates from the bucket of the hit's cell, each one's source probability is 1 / bucket size
+reservoir sampleLocalLights(vec3 pos, vec3 normal){
+	reservoir r=reservoir(-1, 0.0f, 0.0f, 0.0f);
+	int cell=getLightCell(pos);
+	int count=cellLightCounts[cell];
+	
+	for (int i=0; i<LIGHT_CANDIDATES && count > 0; i++){
+		int light=cellLights[cell*LIGHTS_PER_CELL + min(int(random() * count), count - 1)];
+		updateReservoir(r, light, localLightTarget(light, pos, normal) * count, 1.0f);
+	}
+	return r;
+}
@@ -0,0 +1,98 @@
+#version 430
+
+#include "raycast.glsl"
+#include "deferred.glsl"
+#include "reservoir.glsl"
+
+layout(local_size_x=8, local_size_y=8) in;
+
+//last frame's shadow pixel that sampled the same surface, or -1
+ivec2 findHistory(vec3 pos, vec3 normal){
+	vec2 prevPixel=getPrevPixel(pos);
+	ivec2 prevShadowPixel=ivec2(floor((prevPixel - shadowScale / 2) / shadowScale + 0.5f));
+	
+	if (historyValid == 0 || prevPixel.x < 0 ||
+		any(lessThan(prevShadowPixel, ivec2(0, 0))) || any(greaterThanEqual(prevShadowPixel, getShadowSize()))){
+		
+		return ivec2(-1, -1);
+	}
+	vec4 history=imageLoad(shadowHistory, prevShadowPixel);
+	
+	//disocclusion, the history sample hit a different surface
+	if (abs(dot(normal, history.xyz - pos)) > 0.01f || length(history.xyz - pos) > 1.0f){
+		return ivec2(-1, -1);
+	}
+	return prevShadowPixel;
+}
+
+//sun plus one shadow ray to a light resampled from the bucket, last frame's reservoir and two of its neighbours
+float stochasticLightHit(vec3 pos, vec3 normal, ivec2 shadowPixel, ivec2 prevShadowPixel){
+	reservoir r=sampleLocalLights(pos, normal);
+	
+	if (prevShadowPixel.x != -1){
+		mergeReservoir(r, imageLoad(reservoirHistory, prevShadowPixel), pos, normal);
+		
+		for (int i=0; i<2; i++){
+			ivec2 neighbour=clamp(prevShadowPixel + ivec2(random() * 5.0f, random() * 5.0f) - 2, ivec2(0, 0), getShadowSize() - 1);
+			
+			//neighbours on other surfaces would pick lights this pixel can't see
+			if (abs(dot(normal, imageLoad(shadowHistory, neighbour).xyz - pos)) < 0.01f){
+				mergeReservoir(r, imageLoad(reservoirHistory, neighbour), pos, normal);
+			}
+		}
+	}
+	finishReservoir(r, pos, normal);
+	imageStore(reservoirs, shadowPixel, vec4(intBitsToFloat(r.light), r.weight, r.candidates, 0));
+	
+	float multiplier=ambientLight(pos, normal) + sunLight(pos, normal);
+	if (r.light >= 0){
+		multiplier+=localLight(r.light, pos, normal) * r.weight;
+	}
+	return min(multiplier, MAX_OVERBRIGHT);
+}
+
+void main(){
+	ivec2 shadowPixel=ivec2(gl_GlobalInvocationID.xy);
+	
+	if (shadowPixel.x >= getShadowSize().x || shadowPixel.y >= getShadowSize().y){
+		return;
+	}
+	
+	//trace the sun and local lights from one G-buffer hit per block
+	ivec2 pixel=getShadowSamplePixel(shadowPixel);
+	ivec2 hit=imageLoad(gVoxel, pixel).xy;
+	vec3 pos=imageLoad(gPosition, pixel).xyz;
+	float multiplier=AMBIENT;
+	
+	if (hit.x != -1){
+		vec3 normal=decodeNormal(hit.y);
+		ivec2 prevShadowPixel=findHistory(pos, normal);
+		
+#if STOCHASTIC_LIGHTS && !BLOCK_LIGHT
+		//every pixel traces a fixed two rays each frame and accumulates into its history
+		randomState=hashRandom(uint(shadowPixel.x + shadowPixel.y * 4096) ^ hashRandom(uint(frameIndex)));
+		multiplier=stochasticLightHit(pos, normal, shadowPixel, prevShadowPixel);
+		
+		if (prevShadowPixel.x != -1){
+			multiplier=mix(imageLoad(shadowHistory, prevShadowPixel).w, multiplier, STOCHASTIC_BLEND);
+		}
+#else
+		//a rotating quarter of the samples trace every frame, the rest reuse history unless disoccluded
+		int refresh=(shadowPixel.x & 1) + (shadowPixel.y & 1)*2;
+		
+		if (refresh == frameIndex % HISTORY_FRAMES || prevShadowPixel.x == -1){
+			multiplier=lightHit(pos, normal);
+		}
+		else{
+			multiplier=imageLoad(shadowHistory, prevShadowPixel).w;
+		}
+#endif
+	}
+#if STOCHASTIC_LIGHTS
+	else{
+		imageStore(reservoirs, shadowPixel, vec4(intBitsToFloat(-1), 0, 0, 0));
+	}
+#endif
+	
+	imageStore(shadowLight, shadowPixel, vec4(pos, multiplier));
+}
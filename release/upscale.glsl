@@ -0,0 +1,45 @@
+#version 430
+
+//frame rendered at the dynamic resolution in the corner of the window sized frame texture, see updateRenderScale in render.cpp
+layout(binding=0) uniform sampler2D frameColor;
+layout(location=0) uniform vec2 renderSize;
+
+//how fast a tap's weight falls off with its luminance difference to the nearest tap
+const float EDGE_SHARPNESS=8.0f;
+
+out vec4 fColor;
+
+float luminance(vec3 color){
+	return dot(color, vec3(0.299f, 0.587f, 0.114f));
+}
+
+void main(){
+	vec2 windowSize=vec2(textureSize(frameColor, 0));
+	
+	//the same point of the screen in render pixels, kept off the texels past the rendered corner
+	vec2 renderPos=clamp(gl_FragCoord.xy * renderSize / windowSize, vec2(0.5f, 0.5f), renderSize - 0.5f);
+
+#if EDGE_UPSCALE
+	//bilinear weights, each tap faded out when it is across an edge from the nearest one
+	ivec2 base=ivec2(floor(renderPos - 0.5f));
+	vec2 blend=renderPos - 0.5f - base;
+	ivec2 nearest=base + ivec2(greaterThanEqual(blend, vec2(0.5f, 0.5f)));
+	float nearestLuminance=luminance(texelFetch(frameColor, nearest, 0).rgb);
+	vec3 color=vec3(0, 0, 0);
+	float weights=0.0f;
+	
+	for (int i=0; i<4; i++){
+		ivec2 offset=ivec2(i & 1, i >> 1);
+		ivec2 tap=min(base + offset, ivec2(renderSize) - 1);
+		vec3 tapColor=texelFetch(frameColor, tap, 0).rgb;
+		vec2 weight=mix(1.0f - blend, blend, vec2(offset));
+		float edge=exp(-EDGE_SHARPNESS * abs(luminance(tapColor) - nearestLuminance));
+		
+		color+=tapColor * weight.x * weight.y * edge;
+		weights+=weight.x * weight.y * edge;
+	}
+	fColor=vec4(color / weights, 1);
+#else
+	fColor=texture(frameColor, renderPos / windowSize);
+#endif
+}
@@ -0,0 +1,62 @@
+#version 430
+
+//LOD distances count from the view being traced, see getLodLevel
+vec3 viewPos;
+#define LOD_ORIGIN viewPos
+
+#include "raycast.glsl"
+
+//one 8x8 tile of one view per workgroup, the tiles of every view follow each other, see renderViews in views.cpp
+layout(local_size_x=8, local_size_y=8) in;
+
+layout(rgba8, binding=0) writeonly uniform image2D atlas;
+
+struct cameraView{
+	mat4 rotation;
+	vec4 posFov; //position then the tan of half the vertical field of view
+	ivec4 viewport;
+	ivec4 tiles; //first tile then tiles per row
+};
+
+layout(std430, binding=10) readonly buffer viewBuffer{
+	cameraView views[];
+};
+
+layout(location=0) uniform int viewCount;
+layout(location=1) uniform int tileCount;
+
+void main(){
+	int tile=int(gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x);
+	
+	if (tile >= tileCount){
+		return;
+	}
+	
+	//the last view starting at or before this tile, the same for the whole workgroup
+	int view=0;
+	while (view + 1 < viewCount && views[view + 1].tiles.x <= tile){
+		view++;
+	}
+	cameraView camera=views[view];
+	tile-=camera.tiles.x;
+	ivec2 pixel=ivec2(tile % camera.tiles.y, tile / camera.tiles.y) * TILE_SIZE + ivec2(gl_LocalInvocationID.xy);
+	
+	if (pixel.x >= camera.viewport.z || pixel.y >= camera.viewport.w){
+		return;
+	}
+	
+	//the same rays as getRayDirection, spread by the view's own field of view and aspect ratio
+	vec2 screenPos=(pixel + 0.5f) / vec2(camera.viewport.zw) * 2.0f - 1.0f;
+	float viewAspect=float(camera.viewport.z) / float(camera.viewport.w);
+	vec3 rayDirection=normalize(vec3(screenPos.x * viewAspect, screenPos.y, 1.0f / camera.posFov.w));
+	rayDirection=vec3(camera.rotation * vec4(rayDirection, 0));
+	viewPos=camera.posFov.xyz;
+	
+	vec4 fColor=SKY_COLOR;
+	int fColorIndex=castRay(viewPos, rayDirection, renderDist);
+	
+	if (fColorIndex != -1 && readVoxel(fColorIndex) >= 0){
+		fColor=voxelColor(readVoxel(fColorIndex), lightHit(hitPos, hitNormal));
+	}
+	imageStore(atlas, camera.viewport.xy + pixel, fColor);
+}
@@ -0,0 +1,167 @@
+#include "blocklight.hpp"
+
+#include <vector>
+
+static unsigned char blockLight[VOXELS_WIDTH * VOXELS_HEIGHT * VOXELS_WIDTH];
+
+//voxels to spread light from, and voxels whose light came from a removed source with the level they had
+static std::vector<int> lightQueue;
+static std::vector<glm::ivec2> unlightQueue;
+
+//box of voxels changed since the last upload
+static glm::ivec3 dirtyMin, dirtyMax;
+
+static int getSourceLevel(int light){
+	return glm::min((int)(localLights[light].a * BLOCK_LIGHT_SCALE + 0.5f), MAX_BLOCK_LIGHT);
+}
+
+static int getSourceIndex(int light){
+	return getVoxelIndex((int)floor(localLights[light].x), (int)floor(localLights[light].y), (int)floor(localLights[light].z));
+}
+
+static glm::ivec3 getVoxelPos(int index){
+	return glm::ivec3(index % VOXELS_WIDTH, (index / VOXELS_WIDTH) % VOXELS_HEIGHT, index / (VOXELS_WIDTH * VOXELS_HEIGHT));
+}
+
+//index of the voxel next to another one on a face, or -1 off the map
+static int getNeighbourIndex(glm::ivec3 pos, int face){
+	pos[face / 2] += (face & 1) ? -1 : 1;
+	return getVoxelIndex(pos.x, pos.y, pos.z);
+}
+
+static void setLevel(int index, int level){
+	glm::ivec3 pos = getVoxelPos(index);
+	
+	blockLight[index] = level;
+	dirtyMin = glm::min(dirtyMin, pos);
+	dirtyMax = glm::max(dirtyMax, pos);
+	
+	//voxels holding a depth field jump are never in front of a hit so they keep their jump
+	if (voxels[index] < 0 && voxels[index] >= EMPTY_LIGHT_MIN){
+		voxels[index] = -1 - level;
+	}
+}
+
+//only spread once the unlit voxels are cleared, neighbours brighter than the removed light are relit from
+static void unlight(){
+	for (size_t i = 0; i < unlightQueue.size(); i++){
+		glm::ivec3 pos = getVoxelPos(unlightQueue[i].x);
+		int level = unlightQueue[i].y;
+		
+		for (int face = 0; face < 6; face++){
+			int neighbour = getNeighbourIndex(pos, face);
+			
+			if (neighbour != -1 && blockLight[neighbour] != 0){
+				if (blockLight[neighbour] < level){
+					unlightQueue.push_back(glm::ivec2(neighbour, blockLight[neighbour]));
+					setLevel(neighbour, 0);
+				}
+				else{
+					lightQueue.push_back(neighbour);
+				}
+			}
+		}
+	}
+	unlightQueue.clear();
+}
+
+static void spreadLight(){
+	for (size_t i = 0; i < lightQueue.size(); i++){
+		int level = blockLight[lightQueue[i]] - 1;
+		glm::ivec3 pos = getVoxelPos(lightQueue[i]);
+		
+		for (int face = 0; face < 6 && level > 0; face++){
+			int neighbour = getNeighbourIndex(pos, face);
+			
+			if (neighbour != -1 && voxels[neighbour] < 0 && blockLight[neighbour] < level){
+				setLevel(neighbour, level);
+				lightQueue.push_back(neighbour);
+			}
+		}
+	}
+	lightQueue.clear();
+}
+
+static void seedLight(int light){
+	int index = getSourceIndex(light);
+	int level = getSourceLevel(light);
+	
+	if (index != -1 && voxels[index] < 0 && blockLight[index] < level){
+		setLevel(index, level);
+		lightQueue.push_back(index);
+	}
+}
+
+//lights close enough to have lit a cleared box spread into it again
+static void reseedLights(glm::ivec3 boxMin, glm::ivec3 boxMax){
+	for (int i = 0; i < MAX_LOCAL_LIGHTS; i++){
+		if (localLights[i].x >= 0 && localLights[i].y >= 0 && localLights[i].z >= 0){
+			glm::vec3 pos = glm::vec3(localLights[i]);
+			
+			if (glm::length(pos - glm::clamp(pos, glm::vec3(boxMin), glm::vec3(boxMax + 1))) <= MAX_BLOCK_LIGHT){
+				seedLight(i);
+			}
+		}
+	}
+}
+
+static void beginUpdate(){
+	dirtyMin = glm::ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH);
+	dirtyMax = glm::ivec3(-1);
+}
+
+static void endUpdate(){
+	spreadLight();
+	
+	if (dirtyMax.x >= 0){
+		uploadVoxelBox(dirtyMin, dirtyMax);
+	}
+}
+
+void addBlockLight(int light){
+	beginUpdate();
+	seedLight(light);
+	endUpdate();
+}
+
+//pos is where the light was, it must already be moved or marked unused in localLights
+void removeBlockLight(glm::vec3 pos){
+	glm::ivec3 voxel = glm::ivec3(glm::floor(pos));
+	int index = getVoxelIndex(voxel.x, voxel.y, voxel.z);
+	
+	if (index == -1){
+		return;
+	}
+	beginUpdate();
+	if (blockLight[index] != 0){
+		unlightQueue.push_back(glm::ivec2(index, blockLight[index]));
+		setLevel(index, 0);
+		unlight();
+	}
+	reseedLights(voxel, voxel);
+	endUpdate();
+}
+
+//clear the edited box as if its light was removed, then spread back into it from around
+void updateBlockLight(glm::vec3 start, glm::vec3 end){
+	glm::ivec3 boxMin = glm::max(glm::ivec3(glm::min(start, end)), glm::ivec3(0));
+	glm::ivec3 boxMax = glm::min(glm::ivec3(glm::max(start, end)), glm::ivec3(VOXELS_WIDTH-1, VOXELS_HEIGHT-1, VOXELS_WIDTH-1));
+	
+	beginUpdate();
+	for (int z = boxMin.z; z <= boxMax.z; z++){
+		for (int y = boxMin.y; y <= boxMax.y; y++){
+			for (int x = boxMin.x; x <= boxMax.x; x++){
+				int index = getVoxelIndex(x, y, z);
+				
+				if (blockLight[index] != 0){
+					unlightQueue.push_back(glm::ivec2(index, blockLight[index]));
+				}
+				//edits reset empty voxels to -1
+				setLevel(index, 0);
+			}
+		}
+	}
+	unlight();
+	reseedLights(boxMin, boxMax);
+	endUpdate();
+}
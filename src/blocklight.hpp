@@ -0,0 +1,14 @@
+#pragma once
+#include "render.hpp"
+
+//block light levels spread one less per voxel from each local light through empty voxels,
+//a level reads as level / BLOCK_LIGHT_SCALE brightness so a 0.5 light fades out at LOCAL_LIGHT_DIST like traced lights do
+#define BLOCK_LIGHT_SCALE 128
+#define MAX_BLOCK_LIGHT 64
+
+//empty voxels without a depth field jump store -1 - their light level, anything below is a jump
+#define EMPTY_LIGHT_MIN -256
+
+void addBlockLight(int light);
+void removeBlockLight(glm::vec3 pos);
+void updateBlockLight(glm::vec3 start, glm::vec3 end);
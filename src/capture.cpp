@@ -0,0 +1,430 @@
+#include "capture.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fstream>
+#include <iostream>
+
+int recording = 0;
+
+//what a read back frame is written as, the end marker closes the y4m stream after the frames before it
+#define CAPTURE_SCREENSHOT 1
+#define CAPTURE_VIDEO 2
+#define CAPTURE_END 4
+
+struct captureBuffer{
+	GLuint pbo;
+	GLsync fence; //0 while the buffer holds nothing
+	int size;
+	int width, height;
+	int flags;
+};
+
+struct capturedFrame{
+	unsigned char* pixels; //rgba rows, bottom row first as glReadPixels returns them
+	int width, height;
+	int flags;
+};
+
+static struct captureBuffer buffers[CAPTURE_BUFFERS];
+static int nextBuffer = 0;
+static int screenshotPending = 0;
+
+//the last captured frame, copied out of the back buffer and read into the ring on the next capture
+static GLuint stagingTexture, stagingFramebuffer;
+static int stagingWidth = 0, stagingHeight = 0;
+static int stagedWidth, stagedHeight;
+static int stagedFlags = 0;
+
+//frames handed to the encoder thread
+static struct capturedFrame queue[CAPTURE_QUEUE];
+static int queueStart = 0, queueCount = 0;
+static int droppedFrames = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queueSpace = PTHREAD_COND_INITIALIZER;
+static pthread_t encoderThread;
+
+static unsigned int crcTable[256];
+
+static void fileTime(char* out, int size){
+	time_t now = time(NULL);
+	strftime(out, size, "%Y%m%d_%H%M%S", localtime(&now));
+}
+
+static unsigned int updateCrc(unsigned int crc, const unsigned char* data, int length){
+	for (int i = 0; i < length; i++){
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+static void writeBigEndian(unsigned char* out, unsigned int value){
+	out[0] = value >> 24;
+	out[1] = value >> 16;
+	out[2] = value >> 8;
+	out[3] = value;
+}
+
+static void writeChunk(std::ofstream& out, const char* type, const unsigned char* data, int length){
+	unsigned char header[8];
+	unsigned char crc[4];
+	
+	writeBigEndian(header, length);
+	memcpy(header + 4, type, 4);
+	writeBigEndian(crc, ~updateCrc(updateCrc(0xFFFFFFFF, header + 4, 4), data, length));
+	out.write((char*)header, 8);
+	out.write((char*)data, length);
+	out.write((char*)crc, 4);
+}
+
+//stored deflate blocks keep the encoder cheap, screenshots trade size for not needing zlib
+static void writePng(struct capturedFrame* frame, const char* name){
+	int rowSize = frame->width * 3 + 1;
+	int rawSize = rowSize * frame->height;
+	int blocks = (rawSize + 65534) / 65535;
+	int zlibSize = 2 + rawSize + blocks * 5 + 4;
+	unsigned char* raw = (unsigned char*)malloc(rawSize);
+	unsigned char* zlib = (unsigned char*)malloc(zlibSize);
+	
+	//top row first and no filter on any row
+	for (int y = 0; y < frame->height; y++){
+		unsigned char* row = raw + y * rowSize;
+		unsigned char* pixel = frame->pixels + (frame->height - 1 - y) * frame->width * 4;
+		
+		row[0] = 0;
+		for (int x = 0; x < frame->width; x++){
+			memcpy(row + 1 + x * 3, pixel + x * 4, 3);
+		}
+	}
+	
+	unsigned int a = 1, b = 0;
+	unsigned char* out = zlib;
+	*out++ = 0x78;
+	*out++ = 0x01;
+	for (int i = 0; i < rawSize; i += 65535){
+		int length = rawSize - i < 65535 ? rawSize - i : 65535;
+		
+		*out++ = i + length == rawSize;
+		*out++ = length & 0xFF;
+		*out++ = length >> 8;
+		*out++ = ~length & 0xFF;
+		*out++ = (~length >> 8) & 0xFF;
+		memcpy(out, raw + i, length);
+		out += length;
+		
+		for (int j = i; j < i + length; j++){
+			a = (a + raw[j]) % 65521;
+			b = (b + a) % 65521;
+		}
+	}
+	writeBigEndian(out, (b << 16) | a);
+	
+	unsigned char header[13];
+	writeBigEndian(header, frame->width);
+	writeBigEndian(header + 4, frame->height);
+	header[8] = 8; //bits per channel
+	header[9] = 2; //rgb
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+	
+	std::ofstream png(name, std::ios::binary);
+	png.write("\x89PNG\r\n\x1A\n", 8);
+	writeChunk(png, "IHDR", header, 13);
+	writeChunk(png, "IDAT", zlib, zlibSize);
+	writeChunk(png, "IEND", NULL, 0);
+	
+	free(raw);
+	free(zlib);
+}
+
+//full range bt.601 4:2:0, the chroma of each 2x2 block is averaged, odd edges are cropped
+static void writeY4mFrame(std::ofstream& video, struct capturedFrame* frame, int width, int height){
+	int lumaSize = width * height;
+	int chromaSize = lumaSize / 4;
+	unsigned char* planes = (unsigned char*)malloc(lumaSize + chromaSize * 2);
+	unsigned char* cb = planes + lumaSize;
+	unsigned char* cr = cb + chromaSize;
+	
+	for (int y = 0; y < height; y += 2){
+		for (int x = 0; x < width; x += 2){
+			int blue = 0, red = 0;
+			
+			for (int i = 0; i < 4; i++){
+				int px = x + (i & 1);
+				int py = y + (i >> 1);
+				unsigned char* pixel = frame->pixels + ((frame->height - 1 - py) * frame->width + px) * 4;
+				int luma = (19595 * pixel[0] + 38470 * pixel[1] + 7471 * pixel[2] + 32768) >> 16;
+				
+				planes[py * width + px] = luma;
+				blue += pixel[2] - luma;
+				red += pixel[0] - luma;
+			}
+			
+			//cb and cr are 0.564 and 0.713 times the blue and red differences, here over the sum of 4 samples
+			int chroma = (y / 2) * (width / 2) + x / 2;
+			cb[chroma] = glm::clamp(128 + blue * 289 / 2048, 0, 255);
+			cr[chroma] = glm::clamp(128 + red * 365 / 2048, 0, 255);
+		}
+	}
+	
+	video.write("FRAME\n", 6);
+	video.write((char*)planes, lumaSize + chromaSize * 2);
+	free(planes);
+}
+
+static void* encodeFrames(void* args){
+	std::ofstream video;
+	char videoName[64];
+	int videoWidth = 0, videoHeight = 0;
+	int videoFrames = 0, skippedFrames = 0;
+	int screenshots = 0;
+	
+	while (true){
+		pthread_mutex_lock(&queueLock);
+		while (queueCount == 0){
+			pthread_cond_wait(&queueReady, &queueLock);
+		}
+		struct capturedFrame frame = queue[queueStart];
+		queueStart = (queueStart + 1) % CAPTURE_QUEUE;
+		queueCount--;
+		pthread_cond_signal(&queueSpace);
+		pthread_mutex_unlock(&queueLock);
+		
+		if (frame.flags & CAPTURE_SCREENSHOT){
+			char name[64];
+			char now[32];
+			
+			fileTime(now, sizeof(now));
+			sprintf(name, "screenshot_%s_%d.png", now, ++screenshots);
+			writePng(&frame, name);
+			std::cout << "Saved " << name << std::endl;
+		}
+		
+		//the stream keeps the size of its first frame, frames after a resize are left out
+		if (frame.flags & CAPTURE_VIDEO){
+			if (!video.is_open()){
+				char now[32];
+				
+				fileTime(now, sizeof(now));
+				sprintf(videoName, "capture_%s.y4m", now);
+				videoWidth = frame.width & ~1;
+				videoHeight = frame.height & ~1;
+				videoFrames = 0;
+				skippedFrames = 0;
+				video.open(videoName, std::ios::binary);
+				video << "YUV4MPEG2 W" << videoWidth << " H" << videoHeight << " F" << CAPTURE_FPS << ":1 Ip A1:1 C420jpeg\n";
+			}
+			if ((frame.width & ~1) == videoWidth && (frame.height & ~1) == videoHeight){
+				writeY4mFrame(video, &frame, videoWidth, videoHeight);
+				videoFrames++;
+			}
+			else{
+				skippedFrames++;
+			}
+		}
+		
+		if ((frame.flags & CAPTURE_END) && video.is_open()){
+			video.close();
+			
+			pthread_mutex_lock(&queueLock);
+			int dropped = droppedFrames;
+			droppedFrames = 0;
+			pthread_mutex_unlock(&queueLock);
+			
+			std::cout << "Recorded " << videoFrames << " frames to " << videoName << ", " << dropped << " dropped while the encoder was behind, " << skippedFrames << " left out after a resize" << std::endl;
+		}
+		
+		free(frame.pixels);
+	}
+	return NULL;
+}
+
+static int queueIsFull(){
+	pthread_mutex_lock(&queueLock);
+	int full = queueCount == CAPTURE_QUEUE;
+	pthread_mutex_unlock(&queueLock);
+	return full;
+}
+
+//video frames are dropped when the encoder is behind, screenshots and the end marker wait for room instead
+static void queueFrame(struct capturedFrame frame){
+	pthread_mutex_lock(&queueLock);
+	while (queueCount == CAPTURE_QUEUE && frame.flags != CAPTURE_VIDEO){
+		pthread_cond_wait(&queueSpace, &queueLock);
+	}
+	if (queueCount == CAPTURE_QUEUE){
+		droppedFrames++;
+		free(frame.pixels);
+	}
+	else{
+		queue[(queueStart + queueCount) % CAPTURE_QUEUE] = frame;
+		queueCount++;
+		pthread_cond_signal(&queueReady);
+	}
+	pthread_mutex_unlock(&queueLock);
+}
+
+//hands a buffer's frame to the encoder once its fence has passed, returns 0 if the copy is still running
+static int finishBuffer(struct captureBuffer* buffer, int wait){
+	if (buffer->fence == 0){
+		return 1;
+	}
+	
+	GLenum status = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (wait && status == GL_TIMEOUT_EXPIRED){
+		status = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	if (status == GL_TIMEOUT_EXPIRED){
+		return 0;
+	}
+	glDeleteSync(buffer->fence);
+	buffer->fence = 0;
+	
+	//the mapped copy is skipped if the encoder has no room for it anyway
+	struct capturedFrame frame = {NULL, buffer->width, buffer->height, buffer->flags};
+	if (status == GL_WAIT_FAILED || (queueIsFull() && !(buffer->flags & CAPTURE_SCREENSHOT))){
+		frame.flags = 0;
+	}
+	else{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->pbo);
+		void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer->width * buffer->height * 4, GL_MAP_READ_BIT);
+		
+		if (pixels != NULL){
+			frame.pixels = (unsigned char*)malloc(buffer->width * buffer->height * 4);
+			memcpy(frame.pixels, pixels, buffer->width * buffer->height * 4);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	
+	if (frame.pixels != NULL){
+		queueFrame(frame);
+	}
+	else if (frame.flags & CAPTURE_VIDEO){
+		pthread_mutex_lock(&queueLock);
+		droppedFrames++;
+		pthread_mutex_unlock(&queueLock);
+	}
+	return 1;
+}
+
+//oldest first, fences pass in order so the first unfinished one ends the sweep
+static void finishBuffers(int wait){
+	for (int i = 0; i < CAPTURE_BUFFERS; i++){
+		if (!finishBuffer(&buffers[(nextBuffer + i) % CAPTURE_BUFFERS], wait)){
+			break;
+		}
+	}
+}
+
+void initCapture(){
+	for (unsigned int i = 0; i < 256; i++){
+		unsigned int crc = i;
+		
+		for (int j = 0; j < 8; j++){
+			crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+		}
+		crcTable[i] = crc;
+	}
+	
+	for (int i = 0; i < CAPTURE_BUFFERS; i++){
+		glGenBuffers(1, &buffers[i].pbo);
+		buffers[i].fence = 0;
+		buffers[i].size = 0;
+	}
+	glGenFramebuffers(1, &stagingFramebuffer);
+	
+	pthread_create(&encoderThread, NULL, encodeFrames, NULL);
+	pthread_detach(encoderThread);
+}
+
+void requestScreenshot(){
+	screenshotPending = 1;
+	markSceneChanged();
+}
+
+//the staged frame is read into the next buffer of the ring, a buffer still in flight means the gpu is the whole ring behind
+//and only then does capture wait
+static void readStagedFrame(){
+	if (stagedFlags == 0){
+		return;
+	}
+	
+	struct captureBuffer* buffer = &buffers[nextBuffer];
+	finishBuffer(buffer, 1);
+	nextBuffer = (nextBuffer + 1) % CAPTURE_BUFFERS;
+	
+	buffer->width = stagedWidth;
+	buffer->height = stagedHeight;
+	buffer->flags = stagedFlags;
+	
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->pbo);
+	if (buffer->size < stagedWidth * stagedHeight * 4){
+		buffer->size = stagedWidth * stagedHeight * 4;
+		glBufferData(GL_PIXEL_PACK_BUFFER, buffer->size, NULL, GL_STREAM_READ);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, stagingFramebuffer);
+	glReadPixels(0, 0, stagedWidth, stagedHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	
+	stagedFlags = 0;
+}
+
+//stopping waits for the frames still in flight so they land in the stream before it is closed
+void toggleRecording(){
+	recording = !recording;
+	
+	if (!recording){
+		readStagedFrame();
+		finishBuffers(1);
+		
+		struct capturedFrame end = {NULL, 0, 0, CAPTURE_END};
+		queueFrame(end);
+	}
+}
+
+//called before a frame is drawn, the last captured frame was presented so its copy reads back without waiting on
+//or flushing a half built frame, and copies from earlier frames that have landed go to the encoder
+void collectCaptures(){
+	finishBuffers(0);
+	readStagedFrame();
+}
+
+//called once the frame is in the back buffer, it is only copied here and read back by the next collectCaptures
+void captureFrame(){
+	int flags = (screenshotPending ? CAPTURE_SCREENSHOT : 0) | (recording ? CAPTURE_VIDEO : 0);
+	if (flags == 0){
+		return;
+	}
+	
+	if (screenWidth > stagingWidth || screenHeight > stagingHeight){
+		stagingWidth = glm::max(screenWidth, stagingWidth);
+		stagingHeight = glm::max(screenHeight, stagingHeight);
+		
+		glDeleteTextures(1, &stagingTexture);
+		glGenTextures(1, &stagingTexture);
+		glBindTexture(GL_TEXTURE_2D, stagingTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, stagingWidth, stagingHeight);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stagingFramebuffer);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, stagingTexture, 0);
+	}
+	
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stagingFramebuffer);
+	glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	
+	stagedWidth = screenWidth;
+	stagedHeight = screenHeight;
+	stagedFlags = flags;
+	screenshotPending = 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "render.hpp"
+
+//drawn frames are read back into a ring of pixel buffers and only mapped once their fence has passed,
+//so the copy overlaps the next frames instead of stalling on them
+#define CAPTURE_BUFFERS 3
+
+//frames read back but not yet written by the encoder thread, later frames are dropped while it is full
+#define CAPTURE_QUEUE 8
+
+//frame rate written to the y4m header, the stream holds every drawn frame
+#define CAPTURE_FPS 60
+
+//set while frames are streamed to a y4m file
+extern int recording;
+
+void initCapture();
+void requestScreenshot();
+void toggleRecording();
+void collectCaptures();
+void captureFrame();
@@ -0,0 +1,61 @@
+#version 430
+
+#include "raycast.glsl"
+#include "deferred.glsl"
+
+//fills in the pixels tiled.glsl skipped this frame, one per thread, gPosition holds its traced hits
+layout(local_size_x=8, local_size_y=8) in;
+
+//this frame's traced half and last frame's finished frame, see drawFrame in render.cpp
+layout(binding=2) uniform sampler2D tracedFrame;
+layout(binding=3) uniform sampler2D prevFrame;
+
+void main(){
+	ivec2 pixel=ivec2(gl_GlobalInvocationID.xy);
+	pixel.x=pixel.x * 2 + ((pixel.y + frameIndex + 1) & 1);
+	
+	if (!onScreen(pixel)){
+		return;
+	}
+	
+	//the traced neighbours bound the color, the nearest of their hits gives the motion to reproject with
+	vec4 minColor=vec4(1, 1, 1, 1);
+	vec4 maxColor=vec4(0, 0, 0, 0);
+	vec4 colorSum=vec4(0, 0, 0, 0);
+	float neighbours=0.0f;
+	vec4 nearest=vec4(0, 0, 0, -1);
+	ivec2 nearestPixel=pixel;
+	
+	for (int i=0; i<4; i++){
+		ivec2 neighbour=pixel + ivec2(i == 0 ? -1 : i == 1 ? 1 : 0, i == 2 ? -1 : i == 3 ? 1 : 0);
+		
+		if (neighbour.x < 0 || neighbour.y < 0 || !onScreen(neighbour)){
+			continue;
+		}
+		vec4 color=texelFetch(tracedFrame, neighbour, 0);
+		vec4 position=imageLoad(gPosition, neighbour);
+		
+		minColor=min(minColor, color);
+		maxColor=max(maxColor, color);
+		colorSum+=color;
+		neighbours++;
+		
+		if (position.w >= 0.0f && (nearest.w < 0.0f || position.w < nearest.w)){
+			nearest=position;
+			nearestPixel=neighbour;
+		}
+	}
+	vec4 fColor=colorSum / neighbours;
+	
+	//last frame's color where this pixel was, clamped to the neighbours so disocclusions don't ghost
+	if (historyValid == 1 && nearest.w >= 0.0f){
+		vec2 prevPixel=getPrevPixel(nearest.xyz) + vec2(pixel - nearestPixel);
+		
+		if (all(greaterThanEqual(prevPixel, vec2(0, 0))) && all(lessThan(prevPixel, screenSize - 1.0f))){
+			vec4 history=texture(prevFrame, (prevPixel + 0.5f) / vec2(textureSize(prevFrame, 0)));
+			fColor=clamp(history, minColor, maxColor);
+		}
+	}
+	
+	imageStore(frame, pixel, fColor);
+}
@@ -0,0 +1,166 @@
+#include "compress.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+//each brick is a palette of its unique voxel values followed by either
+//bit packed palette indices or runs of (index | length << 16), whichever is smaller
+struct compressThreadData{
+	int start;
+	int end;
+	std::vector<unsigned int> data;
+};
+
+static pthread_t compressThread[THREAD_COUNT];
+static struct compressThreadData compressData[THREAD_COUNT];
+
+//per brick: offset into the data stream, then paletteSize | bits << 16 | mode << 24
+static unsigned int brickHeaders[BRICK_COUNT * 2];
+
+static GLuint decompressProgram, brickBuffer, streamBuffer;
+
+static int getBrickIndex(int x, int y, int z){
+	return x + BRICKS_X * (y + BRICKS_Y * z);
+}
+
+static unsigned int encodeBrick(int bx, int by, int bz, std::vector<unsigned int>& data){
+	unsigned int palette[BRICK_VOXELS];
+	unsigned short indices[BRICK_VOXELS];
+	int paletteSize = 0;
+	int lastIndex = 0;
+	int i = 0;
+	
+	//build palette, voxels next to each other are usually the same so check the last match first
+	for (int z = 0; z < BRICK_SIZE; z++){
+		for (int y = 0; y < BRICK_SIZE; y++){
+			for (int x = 0; x < BRICK_SIZE; x++){
+				unsigned int value = (unsigned int)voxels[getVoxelIndex(bx*BRICK_SIZE + x, by*BRICK_SIZE + y, bz*BRICK_SIZE + z)];
+				
+				if (paletteSize == 0 || palette[lastIndex] != value){
+					lastIndex = 0;
+					while (lastIndex < paletteSize && palette[lastIndex] != value){
+						lastIndex++;
+					}
+					if (lastIndex == paletteSize){
+						palette[paletteSize++] = value;
+					}
+				}
+				indices[i++] = lastIndex;
+			}
+		}
+	}
+	
+	//smallest power of 2 bit width so indices never straddle two words
+	unsigned int bits = 0;
+	while ((1 << bits) < paletteSize){
+		bits = bits ? bits << 1 : 1;
+	}
+	
+	int runs = 1;
+	for (i = 1; i < BRICK_VOXELS; i++){
+		runs += (indices[i] != indices[i-1]);
+	}
+	
+	int packedWords = BRICK_VOXELS * bits / 32;
+	unsigned int mode = runs < packedWords ? BRICK_RLE : BRICK_PACKED;
+	
+	data.insert(data.end(), palette, palette + paletteSize);
+	
+	if (mode == BRICK_RLE){
+		int runStart = 0;
+		for (i = 1; i <= BRICK_VOXELS; i++){
+			if (i == BRICK_VOXELS || indices[i] != indices[runStart]){
+				data.push_back(indices[runStart] | ((i - runStart) << 16));
+				runStart = i;
+			}
+		}
+	}
+	else if (bits > 0){
+		size_t payload = data.size();
+		data.resize(payload + packedWords, 0);
+		for (i = 0; i < BRICK_VOXELS; i++){
+			data[payload + (i*bits) / 32] |= (unsigned int)indices[i] << ((i*bits) % 32);
+		}
+	}
+	
+	return paletteSize | (bits << 16) | (mode << 24);
+}
+
+static void* compressBricks(void* threadData){
+	struct compressThreadData* data = (struct compressThreadData*)threadData;
+	
+	data->data.clear();
+	for (int z = data->start; z < data->end; z++){
+		for (int y = 0; y < BRICKS_Y; y++){
+			for (int x = 0; x < BRICKS_X; x++){
+				int brick = getBrickIndex(x, y, z);
+				
+				//offsets are local to this thread until the streams are joined
+				brickHeaders[brick*2] = data->data.size();
+				brickHeaders[brick*2 + 1] = encodeBrick(x, y, z, data->data);
+			}
+		}
+	}
+	
+	return NULL;
+}
+
+void initCompression(){
+	decompressProgram = InitComputeShader("decompress.glsl");
+	
+	glGenBuffers(1, &brickBuffer);
+	glGenBuffers(1, &streamBuffer);
+}
+
+//voxelStorage is the voxel SSBO, or the voxel texture with VOXEL_TEXTURE
+void uploadCompressedGeometry(GLuint voxelStorage){
+	//threaded brick compression
+	for (int i = 0; i < THREAD_COUNT; i++){
+		compressData[i].start = i*(BRICKS_Z/THREAD_COUNT);
+		compressData[i].end = (i+1)*(BRICKS_Z/THREAD_COUNT);
+		
+		pthread_create(&compressThread[i], NULL, compressBricks, (void*)&compressData[i]);
+	}
+	for (int i = 0; i < THREAD_COUNT; i++){
+		pthread_join(compressThread[i], NULL);
+	}
+	
+	//join thread streams
+	unsigned int streamSize = 0;
+	for (int i = 0; i < THREAD_COUNT; i++){
+		int startBrick = getBrickIndex(0, 0, compressData[i].start);
+		int endBrick = getBrickIndex(0, 0, compressData[i].end);
+		
+		for (int brick = startBrick; brick < endBrick; brick++){
+			brickHeaders[brick*2] += streamSize;
+		}
+		streamSize += compressData[i].data.size();
+	}
+	
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(brickHeaders), brickHeaders, GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, brickBuffer);
+	
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, streamBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, streamSize * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+	unsigned int offset = 0;
+	for (int i = 0; i < THREAD_COUNT; i++){
+		unsigned int size = compressData[i].data.size();
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(unsigned int), size * sizeof(unsigned int), compressData[i].data.data());
+		offset += size;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, streamBuffer);
+	
+	//decompress into the voxel storage, one work group per brick
+	GLint currentProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+#if VOXEL_TEXTURE
+	glBindImageTexture(0, voxelStorage, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32I);
+#else
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, voxelStorage);
+#endif
+	glUseProgram(decompressProgram);
+	glDispatchCompute(BRICKS_X, BRICKS_Y, BRICKS_Z);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glUseProgram(currentProgram);
+}
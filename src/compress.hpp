@@ -0,0 +1,17 @@
+#pragma once
+#include "render.hpp"
+
+//voxels are compressed in 8x8x8 bricks before being sent to the GPU
+#define BRICK_SIZE 8
+#define BRICK_VOXELS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+#define BRICKS_X (VOXELS_WIDTH / BRICK_SIZE)
+#define BRICKS_Y (VOXELS_HEIGHT / BRICK_SIZE)
+#define BRICKS_Z (VOXELS_WIDTH / BRICK_SIZE)
+#define BRICK_COUNT (BRICKS_X * BRICKS_Y * BRICKS_Z)
+
+//brick encodings, stored in the top bits of the brick header
+#define BRICK_PACKED 0
+#define BRICK_RLE 1
+
+void initCompression();
+void uploadCompressedGeometry(GLuint voxelStorage);
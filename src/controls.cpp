@@ -1,5 +1,9 @@
 #include "controls.hpp"
 #include "render.hpp"
+#include "lights.hpp"
+#include "capture.hpp"
+
+#include <iostream>
 
 const float PI = 3.14159f;
 
@@ -7,11 +11,18 @@ const float MAP_EDGE_OFFSET = 1.0f; //camera must stay within 1 block of map bou
 
 static float gravity=0.0f;
 
+static void boundCamera(){
+    camPos.x = glm::min(glm::max(camPos.x, MAP_EDGE_OFFSET), (float)VOXELS_WIDTH - MAP_EDGE_OFFSET - 1);
+    camPos.y = glm::min(glm::max(camPos.y, MAP_EDGE_OFFSET + PLAYER_HEIGHT), (float)VOXELS_HEIGHT - MAP_EDGE_OFFSET - 1);
+    camPos.z = glm::min(glm::max(camPos.z, MAP_EDGE_OFFSET), (float)VOXELS_WIDTH - MAP_EDGE_OFFSET - 1);
+}
+
 int collided(){
 	int collided=0;
 	for (int i=1; i<PLAYER_HEIGHT; i++){
+		//outside the map is empty
 		int index = getVoxelIndex((int)camPos.x, (int)camPos.y - PLAYER_HEIGHT + i, (int)camPos.z);
-		if (voxels[index] > -1){
+		if (index != -1 && voxels[index] > -1){
 			collided = i;
 		}
 	}
@@ -20,10 +31,10 @@ int collided(){
 
 
 void movementUpdate(){
-    float speed = 36.0f / fps;
+    float speed = spectator ? 36.0f * SPECTATOR_SPEED / fps : 36.0f / fps;
     glm::mat4 rot = glm::mat4(1.0f);
     rot = glm::rotate(rot, glm::radians(90.0f), glm::vec3(0, 1, 0));
-	glm::vec3 frontStep = glm::normalize(glm::vec3(camDir.x, 0, camDir.z)) * speed; //ignore Y axis
+	glm::vec3 frontStep = spectator ? glm::normalize(camDir) * speed : glm::normalize(glm::vec3(camDir.x, 0, camDir.z)) * speed; //spectators fly where they look, walking ignores the Y axis
     glm::vec3 sideStep = glm::normalize(glm::vec3(glm::vec4(camDir.x, 0, camDir.z, 0) * rot)) * speed;
 	glm::vec3 stepTaken=glm::vec3(0,0,0);
 	
@@ -44,10 +55,29 @@ void movementUpdate(){
 		stepTaken += -sideStep;
     }
 	if (keys[KEY_T]){
-        placeLocalLight(camPos.x, camPos.y-1.5f, camPos.z, 0.5f);
+        if (placeLocalLight(camPos.x, camPos.y-1.5f, camPos.z, 0.5f) == -1){
+			std::cout << "Light not placed, every light is in use or a grid cell around here is full" << std::endl;
+		}
 		keys[KEY_T] = false;
     }
-	if (keys[SPACE]){
+	if (keys[KEY_Y]){
+		int light = findLocalLight(camPos);
+		if (light != -1 && !moveLocalLight(light, camPos.x, camPos.y-1.5f, camPos.z)){
+			std::cout << "Light not moved, a grid cell around here is full" << std::endl;
+		}
+		keys[KEY_Y] = false;
+    }
+	if (keys[KEY_R]){
+		int light = findLocalLight(camPos);
+		if (light != -1){
+			removeLocalLight(light);
+		}
+		keys[KEY_R] = false;
+    }
+	if (keys[SPACE] && spectator){
+		camPos.y += speed;
+	}
+	else if (keys[SPACE]){
 		int index=getVoxelIndex((int)camPos.x, (int)camPos.y - PLAYER_HEIGHT, (int)camPos.z);
 		if (voxels[index] > -1 && gravity == 0.0f){
 			gravity += 35.0f;
@@ -57,6 +87,94 @@ void movementUpdate(){
 		keys[SHIFT] = false;
 		viewDepthField = !viewDepthField;
     }
+	if (keys[KEY_C]){
+		keys[KEY_C] = false;
+		renderPath = (renderPath + 1) % RENDER_PATHS;
+    }
+	if (keys[KEY_G]){
+		keys[KEY_G] = false;
+		shadowScale = shadowScale == MIN_SHADOW_SCALE ? MAX_SHADOW_SCALE : MIN_SHADOW_SCALE;
+    }
+	if (keys[KEY_L]){
+		keys[KEY_L] = false;
+		stochasticLights = !stochasticLights;
+    }
+	if (keys[KEY_B]){
+		keys[KEY_B] = false;
+		blockLightMode = !blockLightMode;
+		resetLightingHistory();
+    }
+	if (keys[KEY_P]){
+		keys[KEY_P] = false;
+		depthPrepass = !depthPrepass;
+    }
+	if (keys[KEY_O]){
+		keys[KEY_O] = false;
+		shadows = !shadows;
+		resetLightingHistory();
+    }
+	if (keys[KEY_V]){
+		keys[KEY_V] = false;
+		upscaleMode = (upscaleMode + 1) % UPSCALE_MODES;
+    }
+	if (keys[KEY_Q]){
+		keys[KEY_Q] = false;
+		qualityGovernor = !qualityGovernor;
+    }
+	if (keys[KEY_K]){
+		keys[KEY_K] = false;
+		checkerboard = !checkerboard;
+    }
+	if (keys[KEY_M]){
+		keys[KEY_M] = false;
+		if (checkerboard && renderPath == RENDER_TILED){
+			requestCheckerboardMetric();
+		}
+    }
+	if (keys[KEY_I]){
+		keys[KEY_I] = false;
+		changeDriven = !changeDriven;
+    }
+	if (keys[KEY_N]){
+		keys[KEY_N] = false;
+		viewThumbnails = !viewThumbnails;
+    }
+	if (keys[KEY_X]){
+		keys[KEY_X] = false;
+		requestScreenshot();
+    }
+	if (keys[KEY_Z]){
+		keys[KEY_Z] = false;
+		toggleRecording();
+    }
+	if (keys[KEY_H]){
+		keys[KEY_H] = false;
+		frameLimiter = !frameLimiter;
+    }
+	if (keys[KEY_J]){
+		keys[KEY_J] = false;
+		latencyLogging = !latencyLogging;
+    }
+	if (keys[KEY_F]){
+		keys[KEY_F] = false;
+		spectator = !spectator;
+		gravity = 0.0f;
+		
+		//leaving drops the player back into the map above whatever they flew into, the collision check below
+		//only steps back out of terrain walked into
+		if (!spectator){
+			boundCamera();
+			while (collided() && camPos.y < (float)VOXELS_HEIGHT - MAP_EDGE_OFFSET - 1){
+				camPos.y += 1.0f;
+			}
+			return;
+		}
+    }
+	
+	//spectators pass through everything
+	if (spectator){
+		return;
+	}
 	
 	//movement collision check
 	int collision = collided();
@@ -75,12 +193,14 @@ void movementUpdate(){
 
 
 void doGravity(){
+	//the spectator camera stays where it is flown, leaving it drops the player back into the map
+	if (spectator){
+		return;
+	}
 	camPos.y+=gravity / fps;
 	
 	//bound camera
-    camPos.x = glm::min(glm::max(camPos.x, MAP_EDGE_OFFSET), (float)VOXELS_WIDTH - MAP_EDGE_OFFSET - 1);
-    camPos.y = glm::min(glm::max(camPos.y, MAP_EDGE_OFFSET + PLAYER_HEIGHT), (float)VOXELS_HEIGHT - MAP_EDGE_OFFSET - 1);
-    camPos.z = glm::min(glm::max(camPos.z, MAP_EDGE_OFFSET), (float)VOXELS_WIDTH - MAP_EDGE_OFFSET - 1);
+	boundCamera();
 	
 	int index=getVoxelIndex((int)camPos.x, (int)camPos.y - PLAYER_HEIGHT, (int)camPos.z);
 	int collision=collided();
@@ -3,8 +3,12 @@
 
 #define PLAYER_HEIGHT 10
 
+//the spectator camera flies this many times faster than walking
+#define SPECTATOR_SPEED 4.0f
+
 extern float lookX;
 extern float lookY;
+extern int spectator;
 
 void movementUpdate();
 void doMouseLook();
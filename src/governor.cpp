@@ -0,0 +1,114 @@
+#include "governor.hpp"
+#include "lights.hpp"
+
+#include <fstream>
+
+int renderDist = RENDER_DIST;
+int lightDist = LOCAL_LIGHT_DIST;
+int maxLights = LIGHTS_PER_CELL;
+int shadowDist = RENDER_DIST;
+
+//each knob steps through fixed levels, the highest is the full quality the shaders were written for
+struct governorKnob{
+	const char* name;
+	int* value;
+	int levels[6];
+	int levelCount;
+	int level;
+	float cost; //estimated ms one level costs, measured from past changes
+};
+
+static struct governorKnob knobs[] = {
+	{"renderDist", &renderDist, {128, 160, 192, 256, 320, RENDER_DIST}, 6, 5, 2.0f},
+	{"lightDist", &lightDist, {16, 24, 32, 48, LOCAL_LIGHT_DIST}, 5, 4, 1.0f},
+	{"maxLights", &maxLights, {4, 8, 16, 32, 64, LIGHTS_PER_CELL}, 6, 5, 1.0f},
+	{"shadowDist", &shadowDist, {64, 96, 128, 192, 256, RENDER_DIST}, 6, 5, 1.0f},
+};
+static const int knobCount = sizeof(knobs) / sizeof(knobs[0]);
+
+static std::ofstream governorLog;
+static float averageTime = 0.0f;
+static int framesSinceChange = 0;
+static int governorFrame = 0;
+
+//the last change, which way it went and the time before it, measured once the frames have settled
+static int changedKnob = -1;
+static int changedUp;
+static float timeBeforeChange;
+
+static void setKnobLevel(int knob, int level, const char* reason){
+	struct governorKnob* k = &knobs[knob];
+	
+	governorLog << governorFrame << "," << averageTime << "," << k->name << "," << *k->value << "," << k->levels[level] << "," << k->cost << "," << reason << std::endl;
+	
+	changedUp = level > k->level;
+	k->level = level;
+	*k->value = k->levels[level];
+	changedKnob = knob;
+	timeBeforeChange = averageTime;
+	framesSinceChange = 0;
+	markSceneChanged();
+}
+
+void initGovernor(){
+	governorLog.open(GOVERNOR_LOG, std::ios::out | std::ios::trunc);
+	governorLog << "frame,gpuTime,knob,from,to,costEstimate,reason" << std::endl;
+}
+
+void updateGovernor(){
+	governorFrame++;
+	averageTime = averageTime > 0.0f ? glm::mix(averageTime, gpuTime, 0.2f) : gpuTime;
+	
+	if (!qualityGovernor){
+		//back to full quality once it is switched off
+		for (int i = 0; i < knobCount; i++){
+			if (knobs[i].level != knobs[i].levelCount - 1){
+				setKnobLevel(i, knobs[i].levelCount - 1, "off");
+			}
+		}
+		changedKnob = -1;
+		return;
+	}
+	
+	if (framesSinceChange < GOVERNOR_SETTLE_FRAMES){
+		framesSinceChange++;
+		return;
+	}
+	
+	//what the last step saved or cost, a step that made no difference ends up costing nothing
+	if (changedKnob != -1){
+		float measured = changedUp ? averageTime - timeBeforeChange : timeBeforeChange - averageTime;
+		knobs[changedKnob].cost = glm::mix(knobs[changedKnob].cost, glm::max(measured, 0.0f), 0.5f);
+		changedKnob = -1;
+	}
+	
+	//dynamic resolution goes first, the knobs only move once the scale is pinned at an end
+	if (upscaleMode != UPSCALE_OFF && renderScale > MIN_RENDER_SCALE && renderScale < 1.0f){
+		return;
+	}
+	
+	if (averageTime > targetFrameTime * (1.0f + GOVERNOR_OVER)){
+		//lower whatever costs most
+		int knob = -1;
+		for (int i = 0; i < knobCount; i++){
+			if (knobs[i].level > 0 && (knob == -1 || knobs[i].cost > knobs[knob].cost)){
+				knob = i;
+			}
+		}
+		if (knob != -1){
+			setKnobLevel(knob, knobs[knob].level - 1, "over");
+		}
+	}
+	else if (averageTime < targetFrameTime * (1.0f - GOVERNOR_HEADROOM)){
+		//raise the cheapest knob if its cost fits in the headroom
+		int knob = -1;
+		for (int i = 0; i < knobCount; i++){
+			if (knobs[i].level < knobs[i].levelCount - 1 && (knob == -1 || knobs[i].cost < knobs[knob].cost)){
+				knob = i;
+			}
+		}
+		if (knob != -1 && averageTime + knobs[knob].cost < targetFrameTime){
+			setKnobLevel(knob, knobs[knob].level + 1, "headroom");
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "render.hpp"
+
+//the governor steps one quality knob at a time and waits for the timer to show the effect
+#define GOVERNOR_SETTLE_FRAMES 8
+
+//frames over target by this share lower a knob, frames under by this share may raise one
+#define GOVERNOR_OVER 0.1f
+#define GOVERNOR_HEADROOM 0.25f
+
+//every knob change is appended here as csv
+#define GOVERNOR_LOG "governor.csv"
+
+//quality knobs passed to the shaders through the frame UBO
+extern int renderDist;
+extern int lightDist;
+extern int maxLights;
+extern int shadowDist;
+
+void initGovernor();
+void updateGovernor();
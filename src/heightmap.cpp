@@ -0,0 +1,103 @@
+#include "heightmap.hpp"
+
+//empty columns are -1
+static int columnHeights[VOXELS_WIDTH * VOXELS_WIDTH];
+
+//mirrors heightBuffer in raycast.glsl
+static struct{
+	int maxHeight;
+	int tileHeights[HEIGHT_TILES * HEIGHT_TILES];
+} heights;
+
+static char dirtyTiles[HEIGHT_TILES * HEIGHT_TILES];
+static int heightsDirty = 0;
+static GLuint heightBuffer;
+
+static int scanColumn(int x, int y, int z){
+	while (y >= 0 && voxels[getVoxelIndex(x, y, z)] < 0){
+		y--;
+	}
+	return y;
+}
+
+static void markColumn(int x, int z){
+	dirtyTiles[x/HEIGHT_TILE_SIZE + HEIGHT_TILES * (z/HEIGHT_TILE_SIZE)] = 1;
+	heightsDirty = 1;
+}
+
+static void refreshTile(int tx, int tz){
+	int tileHeight = -1;
+	for (int z = tz*HEIGHT_TILE_SIZE; z < (tz+1)*HEIGHT_TILE_SIZE; z++){
+		for (int x = tx*HEIGHT_TILE_SIZE; x < (tx+1)*HEIGHT_TILE_SIZE; x++){
+			tileHeight = glm::max(tileHeight, columnHeights[x + VOXELS_WIDTH * z]);
+		}
+	}
+	heights.tileHeights[tx + HEIGHT_TILES * tz] = tileHeight;
+	dirtyTiles[tx + HEIGHT_TILES * tz] = 0;
+}
+
+void initHeightMap(){
+	for (int z = 0; z < VOXELS_WIDTH; z++){
+		for (int x = 0; x < VOXELS_WIDTH; x++){
+			columnHeights[x + VOXELS_WIDTH * z] = scanColumn(x, VOXELS_HEIGHT - 1, z);
+		}
+	}
+	for (int i = 0; i < HEIGHT_TILES * HEIGHT_TILES; i++){
+		dirtyTiles[i] = 1;
+	}
+	heightsDirty = 1;
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glGenBuffers(1, &heightBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, heightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(heights), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, heightBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+	
+	updateHeightMap();
+}
+
+//rebuild tiles whose columns changed and send the whole map, it is only a few KB
+void updateHeightMap(){
+	if (!heightsDirty){
+		return;
+	}
+	
+	heights.maxHeight = -1;
+	for (int tz = 0; tz < HEIGHT_TILES; tz++){
+		for (int tx = 0; tx < HEIGHT_TILES; tx++){
+			if (dirtyTiles[tx + HEIGHT_TILES * tz]){
+				refreshTile(tx, tz);
+			}
+			heights.maxHeight = glm::max(heights.maxHeight, heights.tileHeights[tx + HEIGHT_TILES * tz]);
+		}
+	}
+	heightsDirty = 0;
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, heightBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(heights), &heights);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+//a solid voxel was placed at (x, y, z)
+void raiseColumn(int x, int y, int z){
+	int* height = &columnHeights[x + VOXELS_WIDTH * z];
+	
+	if (y > *height){
+		*height = y;
+		markColumn(x, z);
+	}
+}
+
+//the voxel at (x, y, z) was emptied, only the top of a column moves the height
+void lowerColumn(int x, int y, int z){
+	int* height = &columnHeights[x + VOXELS_WIDTH * z];
+	
+	if (y == *height){
+		*height = scanColumn(x, y - 1, z);
+		markColumn(x, z);
+	}
+}
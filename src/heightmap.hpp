@@ -0,0 +1,11 @@
+#pragma once
+#include "render.hpp"
+
+//highest solid voxel of every column, with a coarse max over square tiles of columns for the GPU
+#define HEIGHT_TILE_SIZE 16
+#define HEIGHT_TILES (VOXELS_WIDTH / HEIGHT_TILE_SIZE)
+
+void initHeightMap();
+void updateHeightMap();
+void raiseColumn(int x, int y, int z);
+void lowerColumn(int x, int y, int z);
@@ -0,0 +1,447 @@
+#include "lights.hpp"
+#include "blocklight.hpp"
+
+#include <pthread.h>
+#include <string.h>
+
+//cells a light was inserted into and its slot in each of their buckets, used to remove it without searching
+struct lightCells{
+	int count;
+	int cell[MAX_CELLS_PER_LIGHT];
+	int slot[MAX_CELLS_PER_LIGHT];
+};
+
+static struct lightCells lightCellData[MAX_LOCAL_LIGHTS];
+
+//light count per cell followed by every cell's bucket, the same layout as lightGridBuffer in raycast.glsl
+static int cellLightCounts[LIGHT_CELLS];
+static int cellLights[LIGHT_CELLS * LIGHTS_PER_CELL];
+
+//unused light indices, placing pops one and removing pushes it back
+static int freeLights[MAX_LOCAL_LIGHTS];
+static int freeLightCount;
+
+struct lightVolume{
+	int light;
+	int state;
+	glm::vec3 pos;
+	char done;
+	char dirty;
+	char discard;
+	pthread_t thread;
+};
+
+static struct lightVolume lightVolumes[MAX_LIGHT_VOLUMES];
+static unsigned int lightVolumeBits[MAX_LIGHT_VOLUMES][LIGHT_VOLUME_WORDS];
+
+//volume each light owns or -1, the GPU only sees it once the volume is ready
+static int lightVolumeIndices[MAX_LOCAL_LIGHTS];
+
+static GLuint lightBuffer, lightGridBuffer, lightVolumeBuffer;
+
+static int getLightCell(int x, int y, int z){
+	return x + LIGHT_GRID_X * (y + LIGHT_GRID_Y * z);
+}
+
+//partial voxel updates write to whatever SSBO is bound, so every upload puts the old binding back
+static GLint bindBuffer(GLuint buffer){
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	return currentBuffer;
+}
+
+static void uploadLight(int light){
+	GLint currentBuffer = bindBuffer(lightBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, light * sizeof(glm::vec4), sizeof(glm::vec4), &localLights[light]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+	markSceneChanged();
+}
+
+//only the cell's count and the one slot that changed are sent
+static void uploadCellSlot(int cell, int slot){
+	int bucketIndex = cell*LIGHTS_PER_CELL + slot;
+	
+	GLint currentBuffer = bindBuffer(lightGridBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, cell * sizeof(int), sizeof(int), &cellLightCounts[cell]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(cellLightCounts) + bucketIndex * sizeof(int), sizeof(int), &cellLights[bucketIndex]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+//volume indices follow the lights in lightBuffer, -1 makes the shaders trace rays to the light
+static void uploadLightVolumeIndex(int light, int volume){
+	GLint currentBuffer = bindBuffer(lightBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(localLights) + light * sizeof(int), sizeof(int), &volume);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+//same corner the shaders compute from the light position
+static glm::ivec3 getLightVolumeOrigin(glm::vec3 pos){
+	return glm::ivec3((int)floor(pos.x) - LOCAL_LIGHT_DIST, 0, (int)floor(pos.z) - LOCAL_LIGHT_DIST);
+}
+
+static int isSolid(int x, int y, int z){
+	int index = getVoxelIndex(x, y, z);
+	return index != -1 && voxels[index] >= 0;
+}
+
+//voxel walk from a point to a light, blocked by any solid voxel on the way
+static int lightVisible(glm::vec3 start, glm::vec3 end){
+	glm::vec3 dir = end - start;
+	float dist = glm::length(dir);
+	glm::ivec3 voxel = glm::ivec3(glm::floor(start));
+	glm::ivec3 endVoxel = glm::ivec3(glm::floor(end));
+	glm::ivec3 step;
+	glm::vec3 nextIntersect, intersectStep;
+	
+	dir /= dist;
+	for (int i = 0; i < 3; i++){
+		step[i] = dir[i] > 0 ? 1 : -1;
+		intersectStep[i] = dir[i] != 0 ? fabs(1.0f / dir[i]) : 1e30f;
+		nextIntersect[i] = dir[i] != 0 ? (voxel[i] + (step[i] > 0) - start[i]) / dir[i] : 1e30f;
+	}
+	
+	while (voxel != endVoxel){
+		int axis = nextIntersect.x < nextIntersect.y ? (nextIntersect.x < nextIntersect.z ? 0 : 2) : (nextIntersect.y < nextIntersect.z ? 1 : 2);
+		
+		if (nextIntersect[axis] > dist){
+			break;
+		}
+		voxel[axis] += step[axis];
+		nextIntersect[axis] += intersectStep[axis];
+		
+		if (isSolid(voxel.x, voxel.y, voxel.z)){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//only empty voxels next to a solid one can hold a hit, shaders look up the voxel in front of the hit face
+static void* computeLightVolume(void* volumeData){
+	struct lightVolume* volume = (struct lightVolume*)volumeData;
+	unsigned int* bits = lightVolumeBits[volume - lightVolumes];
+	glm::ivec3 origin = getLightVolumeOrigin(volume->pos);
+	
+	memset(bits, 0, sizeof(lightVolumeBits[0]));
+	for (int z = 0; z < LIGHT_VOLUME_WIDTH; z++){
+		for (int y = 0; y < VOXELS_HEIGHT; y++){
+			for (int x = 0; x < LIGHT_VOLUME_WIDTH; x++){
+				glm::ivec3 voxel = origin + glm::ivec3(x, y, z);
+				int index = getVoxelIndex(voxel.x, voxel.y, voxel.z);
+				glm::vec3 center = glm::vec3(voxel) + 0.5f;
+				
+				if (index == -1 || voxels[index] >= 0 || glm::length(center - volume->pos) > LOCAL_LIGHT_DIST + 1){
+					continue;
+				}
+				if (!isSolid(voxel.x-1, voxel.y, voxel.z) && !isSolid(voxel.x+1, voxel.y, voxel.z) &&
+					!isSolid(voxel.x, voxel.y-1, voxel.z) && !isSolid(voxel.x, voxel.y+1, voxel.z) &&
+					!isSolid(voxel.x, voxel.y, voxel.z-1) && !isSolid(voxel.x, voxel.y, voxel.z+1)){
+					
+					continue;
+				}
+				if (lightVisible(center, volume->pos)){
+					int bit = x + LIGHT_VOLUME_WIDTH * (y + VOXELS_HEIGHT * z);
+					bits[bit / 32] |= 1u << (bit % 32);
+				}
+			}
+		}
+	}
+	
+	volume->done = 1;
+	return NULL;
+}
+
+//(re)compute a light's cached shadows, lights that don't get a volume keep tracing rays
+static void requestLightVolume(int light){
+	int volume = lightVolumeIndices[light];
+	
+	if (volume == -1){
+		for (int i = 0; i < MAX_LIGHT_VOLUMES && volume == -1; i++){
+			if (lightVolumes[i].state == VOLUME_FREE){
+				volume = i;
+			}
+		}
+		if (volume == -1){
+			return;
+		}
+		lightVolumes[volume].light = light;
+		lightVolumes[volume].state = VOLUME_PENDING;
+		lightVolumeIndices[light] = volume;
+	}
+	//the running thread may have already read the old voxels, run it again when it's done
+	else if (lightVolumes[volume].state == VOLUME_COMPUTING){
+		lightVolumes[volume].dirty = 1;
+	}
+	else{
+		lightVolumes[volume].state = VOLUME_PENDING;
+	}
+	
+	//trace rays until the new bits are uploaded
+	uploadLightVolumeIndex(light, -1);
+}
+
+static void releaseLightVolume(int light){
+	int volume = lightVolumeIndices[light];
+	
+	if (volume != -1){
+		//a running thread still owns its bits, the volume is freed once it's joined
+		if (lightVolumes[volume].state == VOLUME_COMPUTING){
+			lightVolumes[volume].discard = 1;
+		}
+		else{
+			lightVolumes[volume].state = VOLUME_FREE;
+		}
+		lightVolumeIndices[light] = -1;
+		uploadLightVolumeIndex(light, -1);
+	}
+}
+
+//cells a light at pos reaches, returns how many
+static int findLightCells(glm::vec3 pos, int* cells){
+	glm::ivec3 start = glm::max(glm::ivec3(glm::floor((pos - (float)LOCAL_LIGHT_DIST) / (float)LIGHT_CELL_SIZE)), glm::ivec3(0));
+	glm::ivec3 end = glm::min(glm::ivec3(glm::floor((pos + (float)LOCAL_LIGHT_DIST) / (float)LIGHT_CELL_SIZE)), glm::ivec3(LIGHT_GRID_X-1, LIGHT_GRID_Y-1, LIGHT_GRID_Z-1));
+	int count = 0;
+	
+	for (int z = start.z; z <= end.z; z++){
+		for (int y = start.y; y <= end.y; y++){
+			for (int x = start.x; x <= end.x; x++){
+				glm::vec3 cellMin = glm::vec3(x, y, z) * (float)LIGHT_CELL_SIZE;
+				
+				if (glm::length(pos - glm::clamp(pos, cellMin, cellMin + (float)LIGHT_CELL_SIZE)) <= LOCAL_LIGHT_DIST){
+					cells[count++] = getLightCell(x, y, z);
+				}
+			}
+		}
+	}
+	return count;
+}
+
+//a light goes into every cell it reaches or none, so a full cell can't leave it lighting only part of its range
+static int lightFits(glm::vec3 pos){
+	int cells[MAX_CELLS_PER_LIGHT];
+	int count = findLightCells(pos, cells);
+	
+	for (int i = 0; i < count; i++){
+		if (cellLightCounts[cells[i]] >= LIGHTS_PER_CELL){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//callers check lightFits first
+static void insertLight(int light){
+	int reached[MAX_CELLS_PER_LIGHT];
+	int reachedCount = findLightCells(glm::vec3(localLights[light]), reached);
+	struct lightCells* cells = &lightCellData[light];
+	
+	cells->count = 0;
+	for (int i = 0; i < reachedCount; i++){
+		int cell = reached[i];
+		int slot = cellLightCounts[cell]++;
+		cellLights[cell*LIGHTS_PER_CELL + slot] = light;
+		
+		cells->cell[cells->count] = cell;
+		cells->slot[cells->count] = slot;
+		cells->count++;
+		uploadCellSlot(cell, slot);
+	}
+}
+
+static void eraseLight(int light){
+	struct lightCells* cells = &lightCellData[light];
+	
+	for (int i = 0; i < cells->count; i++){
+		int cell = cells->cell[i];
+		int slot = cells->slot[i];
+		
+		//move the cell's last light into the freed slot
+		int moved = cellLights[cell*LIGHTS_PER_CELL + --cellLightCounts[cell]];
+		cellLights[cell*LIGHTS_PER_CELL + slot] = moved;
+		
+		struct lightCells* movedCells = &lightCellData[moved];
+		for (int j = 0; j < movedCells->count; j++){
+			if (movedCells->cell[j] == cell){
+				movedCells->slot[j] = slot;
+			}
+		}
+		uploadCellSlot(cell, slot);
+	}
+	cells->count = 0;
+}
+
+void initLocalLights(){
+	for (int i=0; i<MAX_LOCAL_LIGHTS; i++){
+		localLights[i].x = -1.0f;
+		localLights[i].y = -1.0f;
+		localLights[i].z = -1.0f;
+		localLights[i].a = 0.0f;
+		
+		//lowest indices are placed first
+		freeLights[i] = MAX_LOCAL_LIGHTS - 1 - i;
+		lightCellData[i].count = 0;
+		lightVolumeIndices[i] = -1;
+	}
+	freeLightCount = MAX_LOCAL_LIGHTS;
+	
+	for (int i=0; i<LIGHT_CELLS; i++){
+		cellLightCounts[i] = 0;
+	}
+	for (int i=0; i<MAX_LIGHT_VOLUMES; i++){
+		lightVolumes[i].state = VOLUME_FREE;
+	}
+	
+	glGenBuffers(1, &lightBuffer);
+	GLint currentBuffer = bindBuffer(lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(localLights) + sizeof(lightVolumeIndices), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(localLights), localLights);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(localLights), sizeof(lightVolumeIndices), lightVolumeIndices);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, lightBuffer);
+	
+	glGenBuffers(1, &lightVolumeBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightVolumeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(lightVolumeBits), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, lightVolumeBuffer);
+	
+	glGenBuffers(1, &lightGridBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(cellLightCounts) + sizeof(cellLights), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(cellLightCounts), cellLightCounts);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, lightGridBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+//-1 when every light is in use or a cell in the light's reach already holds LIGHTS_PER_CELL lights
+int placeLocalLight(float x, float y, float z, float diffuse){
+	if (freeLightCount == 0 || !lightFits(glm::vec3(x, y, z))){
+		return -1;
+	}
+	int light = freeLights[--freeLightCount];
+	
+	localLights[light] = glm::vec4(x, y, z, diffuse);
+	insertLight(light);
+	uploadLight(light);
+	requestLightVolume(light);
+	addBlockLight(light);
+	resetLightingHistory();
+	return light;
+}
+
+//0 and the light stays put when a cell at the new position is full
+int moveLocalLight(int light, float x, float y, float z){
+	glm::vec3 oldPos = glm::vec3(localLights[light]);
+	
+	eraseLight(light);
+	if (!lightFits(glm::vec3(x, y, z))){
+		insertLight(light);
+		return 0;
+	}
+	localLights[light].x = x;
+	localLights[light].y = y;
+	localLights[light].z = z;
+	insertLight(light);
+	uploadLight(light);
+	requestLightVolume(light);
+	removeBlockLight(oldPos);
+	addBlockLight(light);
+	resetLightingHistory();
+	return 1;
+}
+
+void removeLocalLight(int light){
+	glm::vec3 oldPos = glm::vec3(localLights[light]);
+	
+	eraseLight(light);
+	releaseLightVolume(light);
+	localLights[light] = glm::vec4(-1.0f, -1.0f, -1.0f, 0.0f);
+	uploadLight(light);
+	removeBlockLight(oldPos);
+	freeLights[freeLightCount++] = light;
+	resetLightingHistory();
+}
+
+//nearest light that can reach a position, only its cell is searched
+int findLocalLight(glm::vec3 pos){
+	glm::ivec3 cellPos = glm::ivec3(glm::floor(pos / (float)LIGHT_CELL_SIZE));
+	int nearest = -1;
+	float nearestDist = LOCAL_LIGHT_DIST;
+	
+	if (cellPos.x < 0 || cellPos.y < 0 || cellPos.z < 0 || cellPos.x >= LIGHT_GRID_X || cellPos.y >= LIGHT_GRID_Y || cellPos.z >= LIGHT_GRID_Z){
+		return -1;
+	}
+	int cell = getLightCell(cellPos.x, cellPos.y, cellPos.z);
+	
+	for (int i = 0; i < cellLightCounts[cell]; i++){
+		int light = cellLights[cell*LIGHTS_PER_CELL + i];
+		float dist = glm::length(glm::vec3(localLights[light]) - pos);
+		
+		if (dist <= nearestDist){
+			nearest = light;
+			nearestDist = dist;
+		}
+	}
+	return nearest;
+}
+
+//join finished volume threads, upload their bits and start waiting volumes on free threads
+void updateLightVolumes(){
+	int running = 0;
+	
+	for (int i = 0; i < MAX_LIGHT_VOLUMES; i++){
+		struct lightVolume* volume = &lightVolumes[i];
+		
+		if (volume->state == VOLUME_COMPUTING && volume->done){
+			pthread_join(volume->thread, NULL);
+			
+			if (volume->discard){
+				volume->state = VOLUME_FREE;
+			}
+			else if (volume->dirty){
+				volume->state = VOLUME_PENDING;
+			}
+			else{
+				GLint currentBuffer = bindBuffer(lightVolumeBuffer);
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, i * sizeof(lightVolumeBits[0]), sizeof(lightVolumeBits[0]), lightVolumeBits[i]);
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+				
+				volume->state = VOLUME_READY;
+				uploadLightVolumeIndex(volume->light, i);
+				resetLightingHistory();
+				markSceneChanged();
+			}
+		}
+		running += volume->state == VOLUME_COMPUTING;
+	}
+	
+	for (int i = 0; i < MAX_LIGHT_VOLUMES && running < THREAD_COUNT; i++){
+		struct lightVolume* volume = &lightVolumes[i];
+		
+		if (volume->state == VOLUME_PENDING){
+			volume->pos = glm::vec3(localLights[volume->light]);
+			volume->done = 0;
+			volume->dirty = 0;
+			volume->discard = 0;
+			volume->state = VOLUME_COMPUTING;
+			pthread_create(&volume->thread, NULL, computeLightVolume, (void*)volume);
+			running++;
+		}
+	}
+}
+
+//edits only change the shadows of lights that reach the edited box
+void invalidateLightVolumes(glm::vec3 start, glm::vec3 end){
+	glm::vec3 boxMin = glm::min(start, end);
+	glm::vec3 boxMax = glm::max(start, end) + 1.0f;
+	
+	for (int i = 0; i < MAX_LIGHT_VOLUMES; i++){
+		//discarded volumes no longer belong to their light
+		if (lightVolumes[i].state != VOLUME_FREE && lightVolumeIndices[lightVolumes[i].light] == i){
+			glm::vec3 pos = glm::vec3(localLights[lightVolumes[i].light]);
+			
+			if (glm::length(pos - glm::clamp(pos, boxMin, boxMax)) <= LOCAL_LIGHT_DIST + 1){
+				requestLightVolume(lightVolumes[i].light);
+			}
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "render.hpp"
+
+//local lights are bucketed in a world space grid, each light is in every cell it can reach
+//so a hit only has to visit the lights of its own cell
+#define LOCAL_LIGHT_DIST 64
+#define LIGHT_CELL_SIZE 64
+#define LIGHT_GRID_X (VOXELS_WIDTH / LIGHT_CELL_SIZE)
+#define LIGHT_GRID_Y ((VOXELS_HEIGHT + LIGHT_CELL_SIZE - 1) / LIGHT_CELL_SIZE)
+#define LIGHT_GRID_Z (VOXELS_WIDTH / LIGHT_CELL_SIZE)
+#define LIGHT_CELLS (LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z)
+#define LIGHTS_PER_CELL 256
+
+//a light reaches at most 3 cells along each axis
+#define MAX_CELLS_PER_LIGHT 27
+
+//shadows of static lights are cached as one visibility bit per voxel of the full height box around them,
+//computed on worker threads and shared between a fixed number of lights
+#define LIGHT_VOLUME_WIDTH (LOCAL_LIGHT_DIST * 2)
+#define LIGHT_VOLUME_WORDS (LIGHT_VOLUME_WIDTH * VOXELS_HEIGHT * LIGHT_VOLUME_WIDTH / 32)
+#define MAX_LIGHT_VOLUMES 64
+
+//light volume states
+#define VOLUME_FREE 0
+#define VOLUME_PENDING 1
+#define VOLUME_COMPUTING 2
+#define VOLUME_READY 3
+
+void initLocalLights();
+int placeLocalLight(float x, float y, float z, float diffuse);
+int moveLocalLight(int light, float x, float y, float z);
+void removeLocalLight(int light);
+int findLocalLight(glm::vec3 pos);
+void updateLightVolumes();
+void invalidateLightVolumes(glm::vec3 start, glm::vec3 end);
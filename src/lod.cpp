@@ -0,0 +1,125 @@
+#include "lod.hpp"
+
+#include <pthread.h>
+
+struct lodThreadData{
+	int level;
+	int start;
+	int end;
+};
+
+static pthread_t lodThread[THREAD_COUNT];
+static struct lodThreadData lodData[THREAD_COUNT];
+
+static int lodVoxels[LOD_VOXELS];
+
+//index of the first cell of a level in the voxels on the GPU, levels follow the full resolution voxels
+int getLevelStart(int level){
+	int start = 0;
+	for (int i = 0; i < level; i++){
+		start += VOXEL_COUNT >> (3*i);
+	}
+	return start;
+}
+
+//cells of a level in lodVoxels
+static int* getLevel(int level){
+	return &lodVoxels[getLevelStart(level) - VOXEL_COUNT];
+}
+
+static int getLodIndex(int level, int x, int y, int z){
+	return x + (VOXELS_WIDTH >> level) * (y + (VOXELS_HEIGHT >> level) * z);
+}
+
+static int getCell(int level, int x, int y, int z){
+	if (level == 0){
+		return voxels[getVoxelIndex(x, y, z)];
+	}
+	return getLevel(level)[getLodIndex(level, x, y, z)];
+}
+
+//most common color of the solid cells under a cell of the next level up
+static void computeCell(int level, int x, int y, int z){
+	int colors[8];
+	int counts[8];
+	int colorCount = 0;
+	int best = -1;
+	int bestCount = 0;
+	
+	for (int i = 0; i < 8; i++){
+		int cell = getCell(level - 1, x*2 + (i & 1), y*2 + ((i >> 1) & 1), z*2 + (i >> 2));
+		int j = 0;
+		
+		if (cell < 0){
+			continue;
+		}
+		while (j < colorCount && colors[j] != cell){
+			j++;
+		}
+		if (j == colorCount){
+			colors[colorCount] = cell;
+			counts[colorCount++] = 0;
+		}
+		if (++counts[j] > bestCount){
+			best = cell;
+			bestCount = counts[j];
+		}
+	}
+	
+	getLevel(level)[getLodIndex(level, x, y, z)] = best;
+}
+
+static void* computeLod(void* threadData){
+	struct lodThreadData* data = (struct lodThreadData*)threadData;
+	
+	for (int z = data->start; z < data->end; z++){
+		for (int y = 0; y < VOXELS_HEIGHT >> data->level; y++){
+			for (int x = 0; x < VOXELS_WIDTH >> data->level; x++){
+				computeCell(data->level, x, y, z);
+			}
+		}
+	}
+	
+	return NULL;
+}
+
+void initLod(){
+	//threaded downsampling, each level waits for the one below it
+	for (int level = 1; level <= LOD_LEVELS; level++){
+		int depth = VOXELS_WIDTH >> level;
+		
+		for (int i = 0; i < THREAD_COUNT; i++){
+			lodData[i].level = level;
+			lodData[i].start = i*(depth/THREAD_COUNT);
+			lodData[i].end = (i+1)*(depth/THREAD_COUNT);
+			
+			pthread_create(&lodThread[i], NULL, computeLod, (void*)&lodData[i]);
+		}
+		for (int i = 0; i < THREAD_COUNT; i++){
+			pthread_join(lodThread[i], NULL);
+		}
+		
+		glm::ivec3 size = glm::ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) >> level;
+		uploadVoxelLevelBox(level, glm::ivec3(0), size - 1, getLevel(level));
+	}
+}
+
+//rebuild and upload the cells over an inclusive box of edited voxels, level by level
+void updateLod(glm::vec3 start, glm::vec3 end){
+	glm::ivec3 boxMin = glm::max(glm::ivec3(glm::min(start, end)), glm::ivec3(0));
+	glm::ivec3 boxMax = glm::min(glm::ivec3(glm::max(start, end)), glm::ivec3(VOXELS_WIDTH-1, VOXELS_HEIGHT-1, VOXELS_WIDTH-1));
+	
+	for (int level = 1; level <= LOD_LEVELS; level++){
+		boxMin /= 2;
+		boxMax /= 2;
+		
+		for (int z = boxMin.z; z <= boxMax.z; z++){
+			for (int y = boxMin.y; y <= boxMax.y; y++){
+				for (int x = boxMin.x; x <= boxMax.x; x++){
+					computeCell(level, x, y, z);
+				}
+			}
+		}
+		uploadVoxelLevelBox(level, boxMin, boxMax, getLevel(level));
+	}
+}
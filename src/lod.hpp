@@ -0,0 +1,12 @@
+#pragma once
+#include "render.hpp"
+
+//2x, 4x and 8x downsampled voxels stored after the full resolution ones in the voxel SSBO,
+//a cell is solid if any voxel under it is and takes their most common color
+#define LOD_LEVELS 3
+#define VOXEL_COUNT (VOXELS_WIDTH * VOXELS_HEIGHT * VOXELS_WIDTH)
+#define LOD_VOXELS (VOXEL_COUNT/8 + VOXEL_COUNT/64 + VOXEL_COUNT/512)
+
+void initLod();
+void updateLod(glm::vec3 start, glm::vec3 end);
+int getLevelStart(int level);
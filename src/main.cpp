@@ -14,14 +14,34 @@ int fullscreen=0;
 int vsync=1;
 bool keys[KEYS];
 bool keysPress[KEYS];
+int frameDrawn=0;
+int frameLimiter=0;
+int latencyLogging=0;
 
 //mouse look
 float lookX;
 float lookY;
 
+//free camera without gravity, collision or map bounds
+int spectator=0;
+
 //debug
 int viewDepthField=0;
 
+//render path
+int renderPath=RENDER_FRAGMENT;
+int depthPrepass=1;
+int shadowScale=MIN_SHADOW_SCALE;
+int stochasticLights=0;
+int blockLightMode=0;
+int shadows=1;
+int upscaleMode=UPSCALE_OFF;
+int qualityGovernor=0;
+int checkerboard=0;
+int changeDriven=0;
+int viewThumbnails=0;
+float targetFrameTime=16.6f;
+
 //camera data
 glm::vec3 camPos = glm::vec3(195, 55, 155);
 glm::vec3 camDir = glm::vec3(0, 0, 1);
@@ -56,8 +76,7 @@ int main(){
 	
 	//render
 	while (windowLoop()){
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-		
+		//input was just sampled, everything it moves is updated before the frame is drawn from it
 		lightUpdate();
 		movementUpdate();
 		doMouseLook();
@@ -70,6 +89,12 @@ int main(){
 		//testE->update();
 		
 		updateUniforms();
+		
+		//an unchanged scene keeps the last frame on screen
+		if (!isSceneIdle()){
+			drawFrame();
+		}
+		presentFrame();
 	}
 	return 0;
 }
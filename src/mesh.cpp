@@ -0,0 +1,351 @@
+#include "mesh.hpp"
+#include "governor.hpp"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <vector>
+
+//quad corners are packed x | y << 10 | z << 17 with the face's normal code from bit 27, the same code as encodeNormal in deferred.glsl,
+//the voxels the quad covers are packed the same way so meshfshader.glsl can keep its voxel lookups on the quad
+struct meshVertex{
+	unsigned int corner;
+	unsigned int minCell;
+	unsigned int maxCell;
+};
+
+struct meshChunk{
+	int state;
+	char dirty;
+	int quads;
+	GLuint buffer;
+	std::vector<struct meshVertex> vertices; //written by the worker, emptied once uploaded
+};
+
+struct meshWorker{
+	int chunks[CHUNKS_PER_WORKER];
+	std::vector<char> solid; //a snapshot per chunk, taken on the main thread so edits never race the build
+	int count;
+	char running;
+	char done;
+	pthread_t thread;
+};
+
+static struct shaderVariants meshShader = {"meshvshader.glsl", "meshfshader.glsl", 0};
+static struct meshChunk chunks[CHUNK_COUNT];
+static struct meshWorker workers[THREAD_COUNT];
+
+//every chunk is drawn with the same quad indices, sized for the largest chunk so far
+static GLuint meshArray, indexBuffer;
+static int indexQuads = 0;
+
+static unsigned int packCell(glm::ivec3 cell){
+	return cell.x | cell.y << 10 | cell.z << 17;
+}
+
+static int isSolid(glm::ivec3 cell){
+	int index = getVoxelIndex(cell.x, cell.y, cell.z);
+	return index != -1 && voxels[index] >= 0;
+}
+
+static void snapshotChunk(int chunk, char* solid){
+	glm::ivec3 start = glm::ivec3(chunk % CHUNKS_X, (chunk / CHUNKS_X) % CHUNKS_Y, chunk / (CHUNKS_X * CHUNKS_Y)) * CHUNK_SIZE - 1;
+	
+	for (int z = 0; z < SNAPSHOT_SIZE; z++){
+		for (int y = 0; y < SNAPSHOT_SIZE; y++){
+			for (int x = 0; x < SNAPSHOT_SIZE; x++){
+				solid[x + SNAPSHOT_SIZE * (y + SNAPSHOT_SIZE * z)] = isSolid(start + glm::ivec3(x, y, z));
+			}
+		}
+	}
+}
+
+//cell relative to the chunk's origin, -1 to CHUNK_SIZE on each axis
+static int isSnapshotSolid(const char* solid, glm::ivec3 cell){
+	cell += 1;
+	return solid[cell.x + SNAPSHOT_SIZE * (cell.y + SNAPSHOT_SIZE * cell.z)];
+}
+
+static void addQuad(struct meshChunk* chunk, glm::ivec3 minCell, glm::ivec3 size, int axis, int face){
+	glm::ivec3 maxCell = minCell + size - 1;
+	glm::ivec3 corner = minCell;
+	glm::ivec3 u = glm::ivec3(0);
+	glm::ivec3 v = glm::ivec3(0);
+	
+	//the quad lies on the side of its voxels the normal points out of
+	corner[axis] += (face & 1) == 0;
+	u[(axis + 1) % 3] = size[(axis + 1) % 3];
+	v[(axis + 2) % 3] = size[(axis + 2) % 3];
+	
+	glm::ivec3 corners[4] = {corner, corner + u, corner + u + v, corner + v};
+	for (int i = 0; i < 4; i++){
+		struct meshVertex vertex = {packCell(corners[i]) | (unsigned int)face << 27, packCell(minCell), packCell(maxCell)};
+		chunk->vertices.push_back(vertex);
+	}
+}
+
+//greedy meshing, each slice of visible faces is covered by rectangles grown along u then along v,
+//faces of any color merge since the fragment shader looks up the voxel under each pixel
+static void buildChunk(int chunk, const char* solid){
+	glm::ivec3 origin = glm::ivec3(chunk % CHUNKS_X, (chunk / CHUNKS_X) % CHUNKS_Y, chunk / (CHUNKS_X * CHUNKS_Y)) * CHUNK_SIZE;
+	struct meshChunk* c = &chunks[chunk];
+	char mask[CHUNK_SIZE][CHUNK_SIZE];
+	
+	c->vertices.clear();
+	for (int face = 0; face < 6; face++){
+		int axis = face / 2;
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		glm::ivec3 normal = glm::ivec3(0);
+		normal[axis] = (face & 1) == 0 ? 1 : -1;
+		
+		for (int d = 0; d < CHUNK_SIZE; d++){
+			//a face is visible when the voxel in front of it is empty or outside the world
+			for (int j = 0; j < CHUNK_SIZE; j++){
+				for (int i = 0; i < CHUNK_SIZE; i++){
+					glm::ivec3 cell = glm::ivec3(0);
+					cell[axis] = d;
+					cell[u] = i;
+					cell[v] = j;
+					mask[j][i] = isSnapshotSolid(solid, cell) && !isSnapshotSolid(solid, cell + normal);
+				}
+			}
+			
+			for (int j = 0; j < CHUNK_SIZE; j++){
+				for (int i = 0; i < CHUNK_SIZE; i++){
+					if (!mask[j][i]){
+						continue;
+					}
+					int width = 1;
+					while (i + width < CHUNK_SIZE && mask[j][i + width]){
+						width++;
+					}
+					
+					//grow down while the whole width of the next row is visible
+					int height = 1;
+					for (; j + height < CHUNK_SIZE; height++){
+						int k = 0;
+						while (k < width && mask[j + height][i + k]){
+							k++;
+						}
+						if (k < width){
+							break;
+						}
+					}
+					for (int y = j; y < j + height; y++){
+						for (int x = i; x < i + width; x++){
+							mask[y][x] = 0;
+						}
+					}
+					
+					glm::ivec3 minCell = origin;
+					glm::ivec3 size = glm::ivec3(1);
+					minCell[axis] += d;
+					minCell[u] += i;
+					minCell[v] += j;
+					size[u] = width;
+					size[v] = height;
+					addQuad(c, minCell, size, axis, face);
+				}
+			}
+		}
+	}
+}
+
+static void* buildChunks(void* workerData){
+	struct meshWorker* worker = (struct meshWorker*)workerData;
+	
+	for (int i = 0; i < worker->count; i++){
+		buildChunk(worker->chunks[i], &worker->solid[i * SNAPSHOT_VOXELS]);
+	}
+	worker->done = 1;
+	return NULL;
+}
+
+static void uploadChunk(int chunk){
+	struct meshChunk* c = &chunks[chunk];
+	GLint currentBuffer, currentArray;
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &currentBuffer);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentArray);
+	
+	c->quads = c->vertices.size() / 4;
+	glBindBuffer(GL_ARRAY_BUFFER, c->buffer);
+	glBufferData(GL_ARRAY_BUFFER, c->vertices.size() * sizeof(struct meshVertex), c->vertices.data(), GL_STATIC_DRAW);
+	std::vector<struct meshVertex>().swap(c->vertices);
+	
+	if (c->quads > indexQuads){
+		indexQuads = c->quads * 2;
+		std::vector<unsigned int> indices(indexQuads * 6);
+		for (int i = 0; i < indexQuads; i++){
+			const unsigned int quad[6] = {0, 1, 2, 0, 2, 3};
+			for (int j = 0; j < 6; j++){
+				indices[i*6 + j] = i*4 + quad[j];
+			}
+		}
+		glBindVertexArray(meshArray);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	}
+	glBindVertexArray(currentArray);
+	glBindBuffer(GL_ARRAY_BUFFER, currentBuffer);
+	
+	//edited while it was being built, the mesh may have missed the edit
+	c->state = c->dirty ? CHUNK_PENDING : CHUNK_READY;
+	markSceneChanged();
+}
+
+void initMeshes(){
+	GLint currentArray;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentArray);
+	
+	//one vertex buffer per chunk bound in turn, attributes are at locations 0 and 1 of meshvshader.glsl
+	glGenVertexArrays(1, &meshArray);
+	glBindVertexArray(meshArray);
+	glEnableVertexAttribArray(0);
+	glVertexAttribIFormat(0, 1, GL_UNSIGNED_INT, offsetof(struct meshVertex, corner));
+	glVertexAttribBinding(0, 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribIFormat(1, 2, GL_UNSIGNED_INT, offsetof(struct meshVertex, minCell));
+	glVertexAttribBinding(1, 0);
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(currentArray);
+	
+	for (int i = 0; i < CHUNK_COUNT; i++){
+		chunks[i].state = CHUNK_PENDING;
+		chunks[i].dirty = 0;
+		chunks[i].quads = 0;
+		glGenBuffers(1, &chunks[i].buffer);
+	}
+	for (int i = 0; i < THREAD_COUNT; i++){
+		workers[i].running = 0;
+		workers[i].solid.resize(CHUNKS_PER_WORKER * SNAPSHOT_VOXELS);
+	}
+	
+	//build the variant for the starting settings up front
+	GLint currentProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	useShaderVariant(&meshShader);
+	glUseProgram(currentProgram);
+}
+
+//upload what the workers finished and hand out the chunks waiting for a build
+void updateMeshes(){
+	//updateUniforms runs before the world exists during startup
+	if (meshArray == 0){
+		return;
+	}
+	
+	for (int i = 0; i < THREAD_COUNT; i++){
+		struct meshWorker* worker = &workers[i];
+		
+		if (worker->running && worker->done){
+			pthread_join(worker->thread, NULL);
+			worker->running = 0;
+			
+			for (int j = 0; j < worker->count; j++){
+				uploadChunk(worker->chunks[j]);
+			}
+		}
+	}
+	
+	int next = 0;
+	for (int i = 0; i < THREAD_COUNT; i++){
+		struct meshWorker* worker = &workers[i];
+		
+		if (worker->running){
+			continue;
+		}
+		worker->count = 0;
+		for (; next < CHUNK_COUNT && worker->count < CHUNKS_PER_WORKER; next++){
+			if (chunks[next].state == CHUNK_PENDING){
+				chunks[next].state = CHUNK_BUILDING;
+				chunks[next].dirty = 0;
+				snapshotChunk(next, &worker->solid[worker->count * SNAPSHOT_VOXELS]);
+				worker->chunks[worker->count++] = next;
+			}
+		}
+		if (worker->count > 0){
+			worker->done = 0;
+			worker->running = 1;
+			pthread_create(&worker->thread, NULL, buildChunks, (void*)worker);
+		}
+	}
+}
+
+//an edit can hide or uncover faces of the voxels around it, so the box is grown by one
+void invalidateMeshes(glm::vec3 start, glm::vec3 end){
+	glm::ivec3 boxMin = glm::max(glm::ivec3(glm::min(start, end)) - 1, glm::ivec3(0)) / CHUNK_SIZE;
+	glm::ivec3 boxMax = glm::min(glm::ivec3(glm::max(start, end)) + 1, glm::ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) - 1) / CHUNK_SIZE;
+	
+	for (int z = boxMin.z; z <= boxMax.z; z++){
+		for (int y = boxMin.y; y <= boxMax.y; y++){
+			for (int x = boxMin.x; x <= boxMax.x; x++){
+				struct meshChunk* c = &chunks[x + CHUNKS_X * (y + CHUNKS_Y * z)];
+				
+				if (c->state == CHUNK_BUILDING){
+					c->dirty = 1;
+				}
+				else{
+					c->state = CHUNK_PENDING;
+				}
+			}
+		}
+	}
+}
+
+//the primary ray projection, camera space z goes into w so it divides the same way getRayDirection spreads rays
+static glm::mat4 getViewProjection(){
+	glm::mat4 projection = glm::mat4(0.0f);
+	projection[0][0] = 1.0f / aspectRatio;
+	projection[1][1] = 1.0f;
+	projection[2][2] = (MESH_FAR + MESH_NEAR) / (MESH_FAR - MESH_NEAR);
+	projection[2][3] = 1.0f;
+	projection[3][2] = -2.0f * MESH_FAR * MESH_NEAR / (MESH_FAR - MESH_NEAR);
+	
+	return projection * glm::transpose(rotateMatrix) * glm::translate(glm::mat4(1.0f), -camPos);
+}
+
+//chunks past the render distance or with every corner outside the same clip plane are skipped
+static int isChunkVisible(int chunk, glm::mat4 viewProjection){
+	glm::vec3 chunkMin = glm::vec3(chunk % CHUNKS_X, (chunk / CHUNKS_X) % CHUNKS_Y, chunk / (CHUNKS_X * CHUNKS_Y)) * (float)CHUNK_SIZE;
+	glm::vec3 chunkMax = chunkMin + (float)CHUNK_SIZE;
+	
+	if (glm::length(camPos - glm::clamp(camPos, chunkMin, chunkMax)) > renderDist){
+		return 0;
+	}
+	
+	int outside[5] = {0, 0, 0, 0, 0};
+	for (int i = 0; i < 8; i++){
+		glm::vec4 clip = viewProjection * glm::vec4(i & 1 ? chunkMax.x : chunkMin.x, i & 2 ? chunkMax.y : chunkMin.y, i & 4 ? chunkMax.z : chunkMin.z, 1.0f);
+		outside[0] += clip.x < -clip.w;
+		outside[1] += clip.x > clip.w;
+		outside[2] += clip.y < -clip.w;
+		outside[3] += clip.y > clip.w;
+		outside[4] += clip.z < -clip.w;
+	}
+	for (int i = 0; i < 5; i++){
+		if (outside[i] == 8){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//draw every visible chunk into whatever framebuffer is bound
+void drawMeshes(){
+	glm::mat4 viewProjection = getViewProjection();
+	GLint currentArray;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentArray);
+	
+	//viewProjection is at location 0
+	useShaderVariant(&meshShader);
+	glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glBindVertexArray(meshArray);
+	
+	for (int i = 0; i < CHUNK_COUNT; i++){
+		if (chunks[i].quads > 0 && isChunkVisible(i, viewProjection)){
+			glBindVertexBuffer(0, chunks[i].buffer, 0, sizeof(struct meshVertex));
+			glDrawElements(GL_TRIANGLES, chunks[i].quads * 6, GL_UNSIGNED_INT, 0);
+		}
+	}
+	glBindVertexArray(currentArray);
+}
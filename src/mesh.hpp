@@ -0,0 +1,31 @@
+#pragma once
+#include "render.hpp"
+
+//the hybrid path rasterizes primary hits from greedy meshed surfaces of 32x32x32 chunks,
+//built on worker threads and rebuilt only for chunks an edit touches
+#define CHUNK_SIZE 32
+#define CHUNKS_X (VOXELS_WIDTH / CHUNK_SIZE)
+#define CHUNKS_Y (VOXELS_HEIGHT / CHUNK_SIZE)
+#define CHUNKS_Z (VOXELS_WIDTH / CHUNK_SIZE)
+#define CHUNK_COUNT (CHUNKS_X * CHUNKS_Y * CHUNKS_Z)
+
+//chunks one worker thread builds before its meshes are uploaded
+#define CHUNKS_PER_WORKER 32
+
+//workers build from a copy of which voxels are solid, the chunk plus the one voxel border its faces look at
+#define SNAPSHOT_SIZE (CHUNK_SIZE + 2)
+#define SNAPSHOT_VOXELS (SNAPSHOT_SIZE * SNAPSHOT_SIZE * SNAPSHOT_SIZE)
+
+//chunk states
+#define CHUNK_PENDING 0
+#define CHUNK_BUILDING 1
+#define CHUNK_READY 2
+
+//near and far planes of the raster projection, far covers the full render distance
+#define MESH_NEAR 0.05f
+#define MESH_FAR (RENDER_DIST + CHUNK_SIZE)
+
+void initMeshes();
+void updateMeshes();
+void invalidateMeshes(glm::vec3 start, glm::vec3 end);
+void drawMeshes();
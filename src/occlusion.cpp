@@ -0,0 +1,101 @@
+#include "occlusion.hpp"
+
+#include <pthread.h>
+
+struct occlusionThreadData{
+	int start;
+	int end;
+};
+
+static pthread_t occlusionThread[THREAD_COUNT];
+static struct occlusionThreadData occlusionData[THREAD_COUNT];
+
+static unsigned int occlusion[OCCLUSION_WORDS];
+static GLuint occlusionBuffer;
+
+//solid voxels among the 26 around an empty one, past a flat floor's worth
+static unsigned int getOcclusionLevel(int x, int y, int z){
+	int solid = 0;
+	
+	if (voxels[getVoxelIndex(x, y, z)] >= 0){
+		return 0;
+	}
+	for (int zCheck = z-1; zCheck <= z+1; zCheck++){
+		for (int yCheck = y-1; yCheck <= y+1; yCheck++){
+			for (int xCheck = x-1; xCheck <= x+1; xCheck++){
+				int index = getVoxelIndex(xCheck, yCheck, zCheck);
+				solid += (index >= 0 && voxels[index] >= 0);
+			}
+		}
+	}
+	
+	return glm::clamp(solid - OCCLUSION_FLOOR, 0, (1 << OCCLUSION_BITS) - 1);
+}
+
+//words never straddle rows so part of a row can be rebuilt on its own
+static void computeOcclusionWords(int y, int z, int startWord, int endWord){
+	int offset = getVoxelIndex(0, y, z) / OCCLUSION_PER_WORD;
+	
+	for (int word = startWord; word <= endWord; word++){
+		unsigned int bits = 0;
+		for (int i = 0; i < OCCLUSION_PER_WORD; i++){
+			bits |= getOcclusionLevel(word*OCCLUSION_PER_WORD + i, y, z) << (i*OCCLUSION_BITS);
+		}
+		occlusion[offset + word] = bits;
+	}
+}
+
+static void* computeOcclusion(void* threadData){
+	struct occlusionThreadData* data = (struct occlusionThreadData*)threadData;
+	
+	for (int z = data->start; z < data->end; z++){
+		for (int y = 0; y < VOXELS_HEIGHT; y++){
+			computeOcclusionWords(y, z, 0, VOXELS_WIDTH/OCCLUSION_PER_WORD - 1);
+		}
+	}
+	
+	return NULL;
+}
+
+void initOcclusion(){
+	//threaded occlusion of the whole map
+	for (int i = 0; i < THREAD_COUNT; i++){
+		occlusionData[i].start = i*(VOXELS_WIDTH/THREAD_COUNT);
+		occlusionData[i].end = (i+1)*(VOXELS_WIDTH/THREAD_COUNT);
+		
+		pthread_create(&occlusionThread[i], NULL, computeOcclusion, (void*)&occlusionData[i]);
+	}
+	for (int i = 0; i < THREAD_COUNT; i++){
+		pthread_join(occlusionThread[i], NULL);
+	}
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glGenBuffers(1, &occlusionBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, occlusionBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(occlusion), occlusion, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, occlusionBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+//an edit changes the occlusion of every voxel touching it
+void updateOcclusion(glm::vec3 start, glm::vec3 end){
+	glm::ivec3 boxMin = glm::max(glm::ivec3(glm::min(start, end)) - 1, glm::ivec3(0));
+	glm::ivec3 boxMax = glm::min(glm::ivec3(glm::max(start, end)) + 1, glm::ivec3(VOXELS_WIDTH-1, VOXELS_HEIGHT-1, VOXELS_WIDTH-1));
+	
+	int startWord = boxMin.x / OCCLUSION_PER_WORD;
+	int endWord = boxMax.x / OCCLUSION_PER_WORD;
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, occlusionBuffer);
+	for (int z = boxMin.z; z <= boxMax.z; z++){
+		for (int y = boxMin.y; y <= boxMax.y; y++){
+			int offset = getVoxelIndex(0, y, z) / OCCLUSION_PER_WORD + startWord;
+			
+			computeOcclusionWords(y, z, startWord, endWord);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(unsigned int), (endWord - startWord + 1) * sizeof(unsigned int), &occlusion[offset]);
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "render.hpp"
+
+//every empty voxel keeps how boxed in it is, 4 bits each, a face reads the voxel in front of it
+#define OCCLUSION_BITS 4
+#define OCCLUSION_PER_WORD (32 / OCCLUSION_BITS)
+#define OCCLUSION_WORDS (VOXELS_WIDTH * VOXELS_HEIGHT * VOXELS_WIDTH / OCCLUSION_PER_WORD)
+
+//solid neighbours of an empty voxel on a flat floor, fewer is unoccluded
+#define OCCLUSION_FLOOR 9
+
+void initOcclusion();
+void updateOcclusion(glm::vec3 start, glm::vec3 end);
@@ -0,0 +1,38 @@
+#include "probes.hpp"
+
+#include <vector>
+
+static struct shaderVariants probeShader = {NULL, "probes.glsl", SHADER_BLOCK_LIGHT | SHADER_NO_SHADOWS};
+static GLuint probeBuffer;
+
+//first probe of the next frame's budget
+static int probeOffset = 0;
+
+void initProbes(){
+	//probes start fully lit so nothing darkens until they are traced
+	std::vector<float> probes(PROBE_COUNT, 1.0f);
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glGenBuffers(1, &probeBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, probeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, PROBE_COUNT * sizeof(float), probes.data(), GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, probeBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+	
+	//build the variant for the starting settings up front
+	GLint currentProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	useShaderVariant(&probeShader);
+	glUseProgram(currentProgram);
+}
+
+void updateProbes(){
+	//probeOffset is at location 0 in every variant
+	useShaderVariant(&probeShader);
+	glUniform1i(0, probeOffset);
+	glDispatchCompute((PROBES_PER_FRAME + 63) / 64, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	
+	probeOffset = (probeOffset + PROBES_PER_FRAME) % PROBE_COUNT;
+}
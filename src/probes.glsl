@@ -0,0 +1,56 @@
+#version 430
+
+#include "raycast.glsl"
+
+//one invocation per probe of this frame's budget
+layout(local_size_x=64) in;
+
+//see probes.hpp
+const int PROBES_PER_FRAME=512;
+const int PROBE_RAYS=16;
+const int PROBE_RAY_DIST=64;
+const float PROBE_MIN=0.25f;
+const float PROBE_BLEND=0.5f;
+const float GOLDEN_ANGLE=2.39996f;
+
+layout(location=0) uniform int probeOffset;
+
+void main(){
+	if (gl_GlobalInvocationID.x >= PROBES_PER_FRAME){
+		return;
+	}
+	int probe=(probeOffset + int(gl_GlobalInvocationID.x)) % PROBE_COUNT;
+	ivec3 cell=ivec3(probe % PROBE_GRID.x, (probe / PROBE_GRID.x) % PROBE_GRID.y, probe / (PROBE_GRID.x * PROBE_GRID.y));
+	vec3 center=(vec3(cell) + 0.5f) * PROBE_SPACING;
+	
+	//buried probes would darken the surface above them
+	if (readVoxel(getVoxelIndex(ivec3(center))) >= 0){
+		probes[probe]=-1.0f;
+		return;
+	}
+	
+	//sky counts fully, a hit counts as the light its surface reflects back
+	float light=0.0f;
+	for (int i=0; i<PROBE_RAYS; i++){
+		//spherical fibonacci directions, spun every frame so each update sees new ones
+		float y=1.0f - (i + 0.5f) * 2.0f / PROBE_RAYS;
+		float angle=(i + frameIndex) * GOLDEN_ANGLE;
+		vec3 direction=vec3(cos(angle) * sqrt(1.0f - y*y), y, sin(angle) * sqrt(1.0f - y*y));
+		int hit=castRay(center, direction, PROBE_RAY_DIST);
+		
+		if (hit == -1){
+			light+=1.0f;
+		}
+		else{
+			float bounce=AMBIENT + sunLight(hitPos, hitNormal);
+#if BLOCK_LIGHT
+			bounce+=blockLightLevel(hitPos, hitNormal);
+#endif
+			light+=dot(voxelColor(readVoxel(hit), bounce).rgb, vec3(0.299f, 0.587f, 0.114f));
+		}
+	}
+	
+	//in the open half the rays see the ground, that is full ambient
+	float value=clamp(light * 2.0f / PROBE_RAYS, PROBE_MIN, 1.0f);
+	probes[probe]=probes[probe] < 0.0f ? value : mix(probes[probe], value, PROBE_BLEND);
+}
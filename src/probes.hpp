@@ -0,0 +1,10 @@
+#pragma once
+#include "render.hpp"
+
+//one irradiance probe per 8x8x8 voxels, a rotating budget of them is traced each frame
+#define PROBE_SPACING 8
+#define PROBE_COUNT ((VOXELS_WIDTH / PROBE_SPACING) * (VOXELS_HEIGHT / PROBE_SPACING) * (VOXELS_WIDTH / PROBE_SPACING))
+#define PROBES_PER_FRAME 512
+
+void initProbes();
+void updateProbes();
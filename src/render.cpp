@@ -2,9 +2,25 @@
 #include "controls.hpp"
 #include "level.hpp"
 #include "Entity.hpp"
+#include "compress.hpp"
+#include "lights.hpp"
+#include "blocklight.hpp"
+#include "sunmap.hpp"
+#include "heightmap.hpp"
+#include "occlusion.hpp"
+#include "probes.hpp"
+#include "lod.hpp"
+#include "governor.hpp"
+#include "mesh.hpp"
+#include "views.hpp"
+#include "capture.hpp"
 
 #include <pthread.h>
+#include <string.h>
+#include <math.h>
 #include <iostream>
+#include <string>
+#include <vector>
 
 const int NumVertices = 6;
 
@@ -43,8 +59,87 @@ glm::vec4 vertices[NumVertices] = {
     glm::vec4(1, -1, 0, 1),
 };
 
-//uniform locations
-GLuint ssbo, AspectRatio, CamPos, CamRotation, LightPos, RotateMatrix, ViewDepthField, LocalLights;
+//per frame data, laid out to match frameBuffer in raycast.glsl (std140)
+struct frameUniforms{
+	glm::mat4 rotateMatrix;
+	glm::vec3 camPos;
+	float aspectRatio;
+	glm::vec3 lightPos;
+	int shadowScale;
+	glm::vec2 camRotation;
+	glm::vec2 screenSize;
+	int frameIndex;
+	int historyValid;
+	int sunMapReady;
+	int padding; //std140 starts the next matrix on 16 bytes
+	glm::mat4 prevRotateMatrix;
+	glm::vec3 prevCamPos;
+	int renderDist;
+	int lightDist;
+	int maxLights;
+	int shadowDist;
+};
+
+//buffers and programs, voxels live in ssbo or voxelTexture depending on VOXEL_TEXTURE
+GLuint ssbo, ubo;
+#if VOXEL_TEXTURE
+static GLuint voxelTexture;
+#endif
+static struct shaderVariants fragmentShader = {"vshader.glsl", "fshader.glsl", SHADER_DEPTH_VIEW | SHADER_DEPTH_PREPASS | SHADER_BLOCK_LIGHT | SHADER_NO_SHADOWS};
+static struct shaderVariants tiledShader = {NULL, "tiled.glsl", SHADER_DEPTH_VIEW | SHADER_DEPTH_PREPASS | SHADER_BLOCK_LIGHT | SHADER_NO_SHADOWS | SHADER_CHECKERBOARD};
+static struct shaderVariants checkerboardShader = {NULL, "checkerboard.glsl", 0};
+static struct shaderVariants prepassShader = {NULL, "prepass.glsl", 0};
+static struct shaderVariants gbufferShader = {NULL, "gbuffer.glsl", SHADER_DEPTH_VIEW | SHADER_DEPTH_PREPASS};
+static struct shaderVariants shadowShader = {NULL, "shadow.glsl", SHADER_BLOCK_LIGHT | SHADER_STOCHASTIC_LIGHTS | SHADER_NO_SHADOWS};
+static struct shaderVariants resolveShader = {NULL, "resolve.glsl", SHADER_DEPTH_VIEW | SHADER_BLOCK_LIGHT | SHADER_STOCHASTIC_LIGHTS | SHADER_NO_SHADOWS};
+static struct shaderVariants upscaleShader = {"vshader.glsl", "upscale.glsl", SHADER_EDGE_UPSCALE};
+
+//names the SHADER_* flags are defined as in the shaders, in bit order
+static const char* shaderFlagNames[SHADER_FLAGS] = {"DEPTH_VIEW", "DEPTH_PREPASS", "BLOCK_LIGHT", "STOCHASTIC_LIGHTS", "NO_SHADOWS", "EDGE_UPSCALE", "CHECKERBOARD"};
+
+//compute path output, blitted to the window, or every path's output when it is upscaled
+static GLuint frameTexture, frameFramebuffer;
+
+//resolution frames are traced at, the window size unless dynamic resolution scales it down
+static int renderWidth, renderHeight;
+static float scaleIntegral = 1.0f;
+float renderScale = 1.0f;
+
+//last frame's finished frame for checkerboard reconstruction, and whether to compare this frame against a full trace
+static GLuint checkerHistoryTexture;
+static int checkerboardMetric = 0;
+
+//per tile primary ray start distances from the depth prepass
+static GLuint startDepthTexture;
+
+//deferred path G-buffer and reduced rate lighting, lighting ping pongs with last frame's history
+static GLuint gPositionTexture, gVoxelTexture, shadowTextures[2];
+
+//the hybrid path rasterizes into the same G-buffer with a depth buffer of its own
+static GLuint meshFramebuffer, meshDepthBuffer;
+
+//local light reservoirs of the stochastic mode, ping ponged the same way
+static GLuint reservoirTextures[2];
+
+//camera and settings last frame's lighting history was traced with
+static glm::mat4 prevRotateMatrix = glm::mat4(1.0f);
+static glm::vec3 prevCamPos;
+static int prevShadowScale;
+static int prevStochasticLights;
+static int frameIndex = 0;
+static int historyValid = 0;
+
+//change driven rendering, the scene version counts camera, sun, light and voxel changes
+static unsigned int sceneVersion = 1;
+static unsigned int drawnVersion = 0;
+static int settledFrames = 0;
+static glm::mat4 drawnRotateMatrix;
+static glm::vec3 drawnCamPos, drawnLightPos;
+
+//GPU frame timing, double buffered so we never wait on a query
+static GLuint timerQueries[2];
+static int timerFrame = 0;
+float gpuTime = 0.0f;
 
 static void initThreadWork(){
 	for (int i = 0; i < THREAD_COUNT; i++){
@@ -100,7 +195,7 @@ static struct depthIndexData* computeDepthIndices(){
 }
 
 
-// Create a NULL-terminated string by reading the provided file
+// Create a NULL-terminated string by reading the provided file, #include "file" lines are expanded in place
 static char* readShaderSource(const char* shaderFile){
 	FILE* fp = fopen(shaderFile, "rb");
 
@@ -116,41 +211,65 @@ static char* readShaderSource(const char* shaderFile){
 	buf[size] = '\0';
 	fclose(fp);
 
+	std::string source;
+	char* line = buf;
+	while (*line){
+		char* lineEnd = strchr(line, '\n');
+		size_t length = lineEnd ? lineEnd - line + 1 : strlen(line);
+		char* directive = line + strspn(line, " \t");
+		
+		if (strncmp(directive, "#include \"", 10) == 0){
+			std::string includeFile(directive + 10, strcspn(directive + 10, "\"\r\n"));
+			char* included = readShaderSource(includeFile.c_str());
+			
+			if (included == NULL){
+				std::cerr << "Failed to read " << includeFile << std::endl;
+				delete [] buf;
+				return NULL;
+			}
+			source += included;
+			source += "\n";
+			delete [] included;
+		}
+		else{
+			source.append(line, length);
+		}
+		line += length;
+	}
+	delete [] buf;
+
+	buf = new char[source.size() + 1];
+	memcpy(buf, source.c_str(), source.size() + 1);
+
 	return buf;
 }
 
-// Create a GLSL program object from vertex and fragment shader files
-GLuint InitShader(const char* vShaderFile, const char* fShaderFile){
-	struct Shader{
-		const char* filename;
-		GLenum type;
-		GLchar* source;
+// Compile a single shader stage and attach it to the program
+static void attachShader(GLuint program, const char* shaderFile, GLenum type, int flags){
+	GLchar* source = readShaderSource(shaderFile);
+	if (source == NULL){
+		std::cerr << "Failed to read " << shaderFile << std::endl;
+		exit( EXIT_FAILURE );
 	}
-	
-	shaders[2] = {
-		{vShaderFile, GL_VERTEX_SHADER, NULL},
-		{fShaderFile, GL_FRAGMENT_SHADER, NULL}
-	};
-
-	GLuint program = glCreateProgram();
 
-	for (int i = 0; i < 2; ++i){
-	Shader& s = shaders[i];
-	s.source = readShaderSource(s.filename);
-	if (shaders[i].source == NULL){
-		std::cerr << "Failed to read " << s.filename << std::endl;
-		exit( EXIT_FAILURE );
+	//build and render flags go right after the #version line, every flag is defined so #if never sees an unknown name
+	std::string defines = VOXEL_TEXTURE ? "#define VOXEL_TEXTURE 1\n" : "#define VOXEL_TEXTURE 0\n";
+	for (int i = 0; i < SHADER_FLAGS; i++){
+		defines += std::string("#define ") + shaderFlagNames[i] + ((flags >> i) & 1 ? " 1\n" : " 0\n");
 	}
+	std::string flagged(source);
+	flagged.insert(flagged.find('\n') + 1, defines);
+	const GLchar* flaggedSource = flagged.c_str();
 
-	GLuint shader = glCreateShader( s.type );
-	glShaderSource(shader, 1, (const GLchar**) &s.source, NULL);
+	GLuint shader = glCreateShader( type );
+	glShaderSource(shader, 1, &flaggedSource, NULL);
 	glCompileShader(shader);
 
 	GLint  compiled;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 	
 	if (!compiled){
-		std::cerr << s.filename << " failed to compile:" << std::endl;
+		std::cerr << shaderFile << " failed to compile:" << std::endl;
 		GLint  logSize;
 		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
 		char* logMsg = new char[logSize];
@@ -160,11 +279,12 @@ GLuint InitShader(const char* vShaderFile, const char* fShaderFile){
 
 		exit(EXIT_FAILURE);
 	}
-	delete [] s.source;
+	delete [] source;
 
 	glAttachShader( program, shader );
-	}
+}
 
+static void linkProgram(GLuint program){
 	/* link  and error check */
 	glLinkProgram(program);
 
@@ -181,10 +301,75 @@ GLuint InitShader(const char* vShaderFile, const char* fShaderFile){
 
 		exit( EXIT_FAILURE );
 	}
+}
+
+// Create a GLSL program object from vertex and fragment shader files
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile, int flags){
+	GLuint program = glCreateProgram();
+
+	attachShader(program, vShaderFile, GL_VERTEX_SHADER, flags);
+	attachShader(program, fShaderFile, GL_FRAGMENT_SHADER, flags);
+	linkProgram(program);
 
 	return program;
 }
 
+// Create a GLSL program object from a compute shader file
+GLuint InitComputeShader(const char* cShaderFile, int flags){
+	GLuint program = glCreateProgram();
+
+	attachShader(program, cShaderFile, GL_COMPUTE_SHADER, flags);
+	linkProgram(program);
+
+	return program;
+}
+
+//SHADER_* flags of the current render settings
+int getShaderFlags(){
+	int flags = 0;
+	
+	if (viewDepthField){
+		flags |= SHADER_DEPTH_VIEW;
+	}
+	if (depthPrepass){
+		flags |= SHADER_DEPTH_PREPASS;
+	}
+	if (blockLightMode){
+		flags |= SHADER_BLOCK_LIGHT;
+	}
+	if (stochasticLights){
+		flags |= SHADER_STOCHASTIC_LIGHTS;
+	}
+	if (!shadows){
+		flags |= SHADER_NO_SHADOWS;
+	}
+	if (upscaleMode == UPSCALE_EDGE){
+		flags |= SHADER_EDGE_UPSCALE;
+	}
+	if (checkerboard){
+		flags |= SHADER_CHECKERBOARD;
+	}
+	return flags;
+}
+
+//bind the program built for the current settings, a new combination compiles once and stalls that frame
+GLuint useShaderVariant(struct shaderVariants* shader){
+	int flags = getShaderFlags() & shader->flags;
+	GLuint* program = &shader->programs[flags];
+	
+	if (*program == 0){
+		if (shader->vShaderFile != NULL){
+			*program = InitShader(shader->vShaderFile, shader->shaderFile, flags);
+		}
+		else{
+			*program = InitComputeShader(shader->shaderFile, flags);
+		}
+	}
+	glUseProgram(*program);
+	
+	return *program;
+}
+
 
 int getVoxelIndex(int x, int y, int z){
 	int index=-1;
@@ -197,8 +382,62 @@ int getVoxelIndex(int x, int y, int z){
 
 
 void updateGeometry(){
-	//reload all data to SSBO
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(voxels), voxels, GL_DYNAMIC_COPY);
+	//reload all data to the GPU, compressed on the CPU and decompressed on the GPU
+#if VOXEL_TEXTURE
+	uploadCompressedGeometry(voxelTexture);
+	
+	//decompression writes through the frame's image unit
+	glBindImageTexture(0, frameTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+#else
+	uploadCompressedGeometry(ssbo);
+#endif
+	historyValid = 0;
+	markSceneChanged();
+}
+
+void resetLightingHistory(){
+	historyValid = 0;
+}
+
+void markSceneChanged(){
+	sceneVersion++;
+}
+
+//nothing changed since the last frame drawn and every sweep has caught up with the last change
+int isSceneIdle(){
+	//recordings are played back at a fixed rate, so they keep drawing every frame
+	return changeDriven && !recording && sceneVersion == drawnVersion && settledFrames >= IDLE_SETTLE_FRAMES && depthGenerationDone && isSunMapReady();
+}
+
+//upload an inclusive box of one level of voxels, levelVoxels holds the whole level
+void uploadVoxelLevelBox(int level, glm::ivec3 start, glm::ivec3 end, const int* levelVoxels){
+	glm::ivec3 size = glm::ivec3(VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH) >> level;
+	glm::ivec3 boxSize = end - start + 1;
+	
+#if VOXEL_TEXTURE
+	//one call for the whole box, the unpack lengths step over the rest of the level
+	glActiveTexture(GL_TEXTURE1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, size.y);
+	glTexSubImage3D(GL_TEXTURE_3D, level, start.x, start.y, start.z, boxSize.x, boxSize.y, boxSize.z, GL_RED_INTEGER, GL_INT,
+		&levelVoxels[start.x + size.x * (start.y + size.y * start.z)]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glActiveTexture(GL_TEXTURE0);
+#else
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	for (int z = start.z; z <= end.z; z++){
+		for (int y = start.y; y <= end.y; y++){
+			int offset = start.x + size.x * (y + size.y * z);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, (getLevelStart(level) + offset) * sizeof(int), boxSize.x * sizeof(int), &levelVoxels[offset]);
+		}
+	}
+#endif
+}
+
+//upload an inclusive box of full resolution voxels
+void uploadVoxelBox(glm::ivec3 start, glm::ivec3 end){
+	uploadVoxelLevelBox(0, start, end, voxels);
 }
 
 void updatePartialGeometry(glm::vec3 start, glm::vec3 end){
@@ -210,16 +449,25 @@ void updatePartialGeometry(glm::vec3 start, glm::vec3 end){
 		start = end;
 		end = temp;
 	}
-	//reload partial data to SSBO
-	int xLength=(int)(end.x-start.x)+1;
-	for (float i = start.z; i < end.z; i++){
-		for (float j = start.y; j < end.y; j++){
-			int offset = getVoxelIndex((int)start.x, (int)j, (int)i);
-			if (offset != -1){
-				glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(int), xLength * sizeof(int), &voxels[offset]);
-			}
-		}
+	//a spectator camera outside the map can aim edits past its edge
+	glm::ivec3 boxMin = glm::max(glm::ivec3(glm::min(start, end)), glm::ivec3(0));
+	glm::ivec3 boxMax = glm::min(glm::ivec3(glm::max(start, end)), glm::ivec3(VOXELS_WIDTH-1, VOXELS_HEIGHT-1, VOXELS_WIDTH-1));
+	if (boxMin.x > boxMax.x || boxMin.y > boxMax.y || boxMin.z > boxMax.z){
+		return;
 	}
+	
+	//edits can uncover or cast shadows anywhere so lighting history is thrown away
+	historyValid = 0;
+	markSceneChanged();
+	invalidateLightVolumes(start, end);
+	invalidateMeshes(start, end);
+	invalidateSunMap(start, end);
+	updateBlockLight(start, end);
+	updateOcclusion(start, end);
+	updateLod(start, end);
+	
+	//reload partial data to the GPU
+	uploadVoxelBox(boxMin, boxMax);
 }
 
 
@@ -258,6 +506,12 @@ void placeVoxel(int x, int y, int z, int voxel){
 	
 	if (index >= 0){
 		voxels[index] = voxel;
+		if (voxel >= 0){
+			raiseColumn(x, y, z);
+		}
+		else{
+			lowerColumn(x, y, z);
+		}
 	}
 }
 
@@ -265,8 +519,9 @@ void placeVoxel(int x, int y, int z, int voxel){
 void destroyVoxel(int x, int y, int z){
 	int index = getVoxelIndex(x, y, z);
 	
-	if (x >= 0 && y >= 0 && z >= 0 && index < VOXELS_WIDTH * VOXELS_HEIGHT * VOXELS_WIDTH){
+	if (index >= 0){
 		voxels[index] = -1;
+		lowerColumn(x, y, z);
 	}
 }
 
@@ -287,13 +542,46 @@ static void* computeDepthField(void* threadData){
 
 
 void updateUniforms(){
-	glUniform1f(AspectRatio, aspectRatio);
-	glUniform3f(CamPos, camPos.x, camPos.y, camPos.z);
-	glUniform2f(CamRotation, camRotation.x, camRotation.y);
-	glUniform3f(LightPos, lightPos.x, lightPos.y, lightPos.z);
-	glUniformMatrix4fv(RotateMatrix, 1, GL_FALSE, glm::value_ptr(rotateMatrix));
-	glUniform1i(ViewDepthField, viewDepthField);
-	glUniform4fv(LocalLights, MAX_LOCAL_LIGHTS, glm::value_ptr(*localLights));
+	struct frameUniforms uniforms;
+	
+	if (camPos != drawnCamPos || rotateMatrix != drawnRotateMatrix || lightPos != drawnLightPos){
+		drawnCamPos = camPos;
+		drawnRotateMatrix = rotateMatrix;
+		drawnLightPos = lightPos;
+		markSceneChanged();
+	}
+	
+	uniforms.rotateMatrix = rotateMatrix;
+	uniforms.camPos = camPos;
+	uniforms.aspectRatio = aspectRatio;
+	uniforms.lightPos = lightPos;
+	uniforms.camRotation = camRotation;
+	uniforms.screenSize = glm::vec2(renderWidth, renderHeight);
+	uniforms.shadowScale = shadowScale;
+	uniforms.frameIndex = frameIndex;
+	uniforms.historyValid = historyValid && shadowScale == prevShadowScale && stochasticLights == prevStochasticLights;
+	uniforms.prevRotateMatrix = prevRotateMatrix;
+	uniforms.prevCamPos = prevCamPos;
+	uniforms.sunMapReady = isSunMapReady();
+	uniforms.renderDist = renderDist;
+	uniforms.lightDist = lightDist;
+	uniforms.maxLights = maxLights;
+	uniforms.shadowDist = shadowDist;
+	uniforms.padding = 0;
+	
+	//shared by every program through binding 0
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniforms), &uniforms);
+	
+	//only the deferred path and checkerboard tiled frames write history for the next frame
+	prevRotateMatrix = rotateMatrix;
+	prevCamPos = camPos;
+	prevShadowScale = shadowScale;
+	prevStochasticLights = stochasticLights;
+	historyValid = renderPath == RENDER_DEFERRED || renderPath == RENDER_HYBRID || (renderPath == RENDER_TILED && checkerboard);
+	
+	updateLightVolumes();
+	updateMeshes();
 	
 	if (!depthGenerationDone && checkThreadsDone()){
 		depthGenerationDone = 1;
@@ -301,13 +589,303 @@ void updateUniforms(){
 	}
 }
 
-void initLocalLights(){
-	for (int i=0; i<MAX_LOCAL_LIGHTS; i++){
-		localLights[i].x = -1.0f;
-		localLights[i].y = -1.0f;
-		localLights[i].z = -1.0f;
-		localLights[i].a = 0.0f;
+//(re)create a texture and bind it to an image unit for the compute passes
+static void initImage(GLuint* texture, GLuint unit, GLenum format, int width, int height){
+	glDeleteTextures(1, texture);
+	glGenTextures(1, texture);
+	glBindTexture(GL_TEXTURE_2D, *texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+	glBindImageTexture(unit, *texture, 0, GL_FALSE, 0, GL_READ_WRITE, format);
+}
+
+static void initFrameTarget(int width, int height){
+	//minimized windows have no size
+	if (width <= 0 || height <= 0){
+		return;
 	}
+	
+	initImage(&frameTexture, 0, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	
+	glDeleteTextures(1, &checkerHistoryTexture);
+	glGenTextures(1, &checkerHistoryTexture);
+	glBindTexture(GL_TEXTURE_2D, checkerHistoryTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameTexture, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	
+	//one start distance per tile
+	initImage(&startDepthTexture, 1, GL_R32F, (width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE);
+	
+	//lighting is sized for the smallest scale so switching scale needs no new textures
+	initImage(&gPositionTexture, 2, GL_RGBA32F, width, height);
+	initImage(&gVoxelTexture, 3, GL_RG32I, width, height);
+	
+	glDeleteRenderbuffers(1, &meshDepthBuffer);
+	glGenRenderbuffers(1, &meshDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, meshDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, meshFramebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPositionTexture, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gVoxelTexture, 0);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, meshDepthBuffer);
+	const GLenum meshTargets[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+	glDrawBuffers(2, meshTargets);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	for (int i = 0; i < 2; i++){
+		initImage(&shadowTextures[i], 4 + i, GL_RGBA32F, (width + MIN_SHADOW_SCALE - 1) / MIN_SHADOW_SCALE, (height + MIN_SHADOW_SCALE - 1) / MIN_SHADOW_SCALE);
+		initImage(&reservoirTextures[i], 6 + i, GL_RGBA32F, (width + MIN_SHADOW_SCALE - 1) / MIN_SHADOW_SCALE, (height + MIN_SHADOW_SCALE - 1) / MIN_SHADOW_SCALE);
+	}
+	historyValid = 0;
+}
+
+static void dispatchTiles(struct shaderVariants* computeShader, int width, int height){
+	useShaderVariant(computeShader);
+	glDispatchCompute((width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE, 1);
+}
+
+//read back the rendered corner of the frame texture as RGBA rows,
+//only that box is read since the texture keeps its old size while the window is minimized
+static std::vector<unsigned char> readFrameTexture(){
+	std::vector<unsigned char> frame(renderWidth * renderHeight * 4);
+	
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+	
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFramebuffer);
+	glReadPixels(0, 0, renderWidth, renderHeight, GL_RGBA, GL_UNSIGNED_BYTE, frame.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	return frame;
+}
+
+//trace the frame just reconstructed again at full rate and print how far the reconstruction is from it
+static void measureCheckerboard(){
+	std::vector<unsigned char> reconstructed = readFrameTexture();
+	
+	//the full trace is the variant without the checkerboard flag, it is also what gets shown this frame
+	checkerboard = 0;
+	dispatchTiles(&tiledShader, renderWidth, renderHeight);
+	checkerboard = 1;
+	std::vector<unsigned char> reference = readFrameTexture();
+	
+	double squaredError = 0.0;
+	double absoluteError = 0.0;
+	int pixelsOff = 0;
+	for (size_t i = 0; i < reference.size(); i += 4){
+		int maxError = 0;
+		for (int c = 0; c < 3; c++){
+			int error = abs(reconstructed[i + c] - reference[i + c]);
+			squaredError += error * error;
+			absoluteError += error;
+			maxError = glm::max(maxError, error);
+		}
+		pixelsOff += maxError > CHECKERBOARD_METRIC_THRESHOLD;
+	}
+	
+	double samples = reference.size() / 4 * 3;
+	double psnr = squaredError > 0.0 ? 10.0 * log10(255.0 * 255.0 / (squaredError / samples)) : INFINITY;
+	std::cout << "Checkerboard vs full trace: PSNR " << psnr << "dB, mean error " << absoluteError / samples << ", "
+		<< 100.0 * pixelsOff / (reference.size() / 4) << "% of pixels off by more than " << CHECKERBOARD_METRIC_THRESHOLD << std::endl;
+}
+
+void requestCheckerboardMetric(){
+	checkerboardMetric = 1;
+}
+
+static void presentFrameTexture(){
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+	
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameFramebuffer);
+	glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+//draw the frame texture's rendered corner over the whole window
+static void upscaleFrameTexture(){
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	
+	//renderSize is at location 0 in every variant
+	useShaderVariant(&upscaleShader);
+	glUniform2f(0, renderWidth, renderHeight);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, frameTexture);
+	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+}
+
+//size of the render target for the current scale, in steps so the deferred path keeps its history most frames
+static void applyRenderScale(){
+	float scale = upscaleMode == UPSCALE_OFF ? 1.0f : glm::round(renderScale * RENDER_SCALE_STEPS) / RENDER_SCALE_STEPS;
+	int width = glm::max(1, (int)(screenWidth * scale + 0.5f));
+	int height = glm::max(1, (int)(screenHeight * scale + 0.5f));
+	
+	if (width != renderWidth || height != renderHeight){
+		renderWidth = width;
+		renderHeight = height;
+		historyValid = 0;
+		markSceneChanged();
+	}
+}
+
+//PI controller on the measured GPU time, the integral settles on the scale that holds the target
+static void updateRenderScale(){
+	if (upscaleMode == UPSCALE_OFF){
+		renderScale = 1.0f;
+		scaleIntegral = 1.0f;
+	}
+	else if (gpuTime > 0.0f){
+		float error = (targetFrameTime - gpuTime) / targetFrameTime;
+		
+		//the integral is clamped to the scale range so it never winds up past it
+		scaleIntegral = glm::clamp(scaleIntegral + error * RENDER_SCALE_KI, MIN_RENDER_SCALE, 1.0f);
+		renderScale = glm::clamp(scaleIntegral + error * RENDER_SCALE_KP, MIN_RENDER_SCALE, 1.0f);
+	}
+	applyRenderScale();
+}
+
+//hybrid primary hits, the chunk meshes are depth tested into the G-buffer in place of the traced pass
+static void rasterizePrimaryHits(){
+	const GLfloat noPosition[4] = {0, 0, 0, -1};
+	const GLint noVoxel[4] = {-1, 0, 0, 0};
+	const GLfloat farDepth = 1.0f;
+	
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, meshFramebuffer);
+	glViewport(0, 0, renderWidth, renderHeight);
+	glClearBufferfv(GL_COLOR, 0, noPosition);
+	glClearBufferiv(GL_COLOR, 1, noVoxel);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	
+	glEnable(GL_DEPTH_TEST);
+	drawMeshes();
+	glDisable(GL_DEPTH_TEST);
+	
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glViewport(0, 0, screenWidth, screenHeight);
+}
+
+static void beginGpuTimer(){
+	glBeginQuery(GL_TIME_ELAPSED, timerQueries[timerFrame & 1]);
+}
+
+static void endGpuTimer(){
+	glEndQuery(GL_TIME_ELAPSED);
+	timerFrame++;
+	
+	//the other query is from last frame and has usually finished by now
+	if (timerFrame > 1){
+		GLint available;
+		glGetQueryObjectiv(timerQueries[timerFrame & 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		
+		if (available){
+			GLuint64 elapsed;
+			glGetQueryObjectui64v(timerQueries[timerFrame & 1], GL_QUERY_RESULT, &elapsed);
+			gpuTime = elapsed / 1000000.0f;
+		}
+	}
+}
+
+void drawFrame(){
+	int tilesX = (renderWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (renderHeight + TILE_SIZE - 1) / TILE_SIZE;
+	
+	//frames keep being drawn until the sweeps below have settled after the last change
+	settledFrames = sceneVersion == drawnVersion ? settledFrames + 1 : 0;
+	drawnVersion = sceneVersion;
+	frameDrawn = 1;
+	
+	collectCaptures();
+	
+	beginGpuTimer();
+	
+	//keep the sun visibility map following the sun and the height map following edits
+	updateSunMap();
+	updateHeightMap();
+	
+	//trace this frame's share of the irradiance probes
+	updateProbes();
+	
+	if (depthPrepass && renderPath != RENDER_HYBRID){
+		//march one cone per tile at 1/8 resolution, rasterized primary hits need no start distances
+		dispatchTiles(&prepassShader, tilesX, tilesY);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	
+	if (renderPath == RENDER_TILED){
+		//trace 8x8 tiles into the frame texture, checkerboard tiles are 16x8 with half the pixels traced
+		dispatchTiles(&tiledShader, checkerboard ? (renderWidth + 1) / 2 : renderWidth, renderHeight);
+		
+		if (checkerboard){
+			//fill in the untraced half from the traced one and last frame, which is then kept for the next frame
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+			glActiveTexture(GL_TEXTURE2);
+			glBindTexture(GL_TEXTURE_2D, frameTexture);
+			glActiveTexture(GL_TEXTURE3);
+			glBindTexture(GL_TEXTURE_2D, checkerHistoryTexture);
+			glActiveTexture(GL_TEXTURE0);
+			dispatchTiles(&checkerboardShader, (renderWidth + 1) / 2, renderHeight);
+			
+			glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+			glCopyImageSubData(frameTexture, GL_TEXTURE_2D, 0, 0, 0, 0, checkerHistoryTexture, GL_TEXTURE_2D, 0, 0, 0, 0, renderWidth, renderHeight, 1);
+			
+			if (checkerboardMetric){
+				measureCheckerboard();
+				checkerboardMetric = 0;
+			}
+		}
+	}
+	else if (renderPath == RENDER_DEFERRED || renderPath == RENDER_HYBRID){
+		//primary hits at full rate, traced or rasterized, lighting at 1/shadowScale rate, then upsample and shade
+		if (renderPath == RENDER_HYBRID){
+			rasterizePrimaryHits();
+		}
+		else{
+			dispatchTiles(&gbufferShader, renderWidth, renderHeight);
+		}
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+		
+		//this frame's lighting is next frame's history
+		glBindImageTexture(4, shadowTextures[frameIndex & 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+		glBindImageTexture(5, shadowTextures[(frameIndex + 1) & 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+		glBindImageTexture(6, reservoirTextures[frameIndex & 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+		glBindImageTexture(7, reservoirTextures[(frameIndex + 1) & 1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+		dispatchTiles(&shadowShader, (renderWidth + shadowScale - 1) / shadowScale, (renderHeight + shadowScale - 1) / shadowScale);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		dispatchTiles(&resolveShader, renderWidth, renderHeight);
+	}
+	else if (upscaleMode != UPSCALE_OFF){
+		//scaled fragment frames go into the frame texture like the compute paths
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameFramebuffer);
+		glViewport(0, 0, renderWidth, renderHeight);
+		useShaderVariant(&fragmentShader);
+		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glViewport(0, 0, screenWidth, screenHeight);
+	}
+	else{
+		useShaderVariant(&fragmentShader);
+		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+	}
+	
+	if (upscaleMode != UPSCALE_OFF){
+		upscaleFrameTexture();
+	}
+	else if (renderPath != RENDER_FRAGMENT){
+		presentFrameTexture();
+	}
+	
+	if (viewThumbnails){
+		drawViewThumbnails();
+	}
+	
+	captureFrame();
+	endGpuTimer();
+	frameIndex++;
+	
+	//next frame's resolution and quality from the frame time just measured
+	updateRenderScale();
+	updateGovernor();
 }
 
 void initRender(){
@@ -322,23 +900,30 @@ void initRender(){
 	glBindBuffer( GL_ARRAY_BUFFER, buffer );
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 	
-	// Load shaders and use the resulting shader program
-	GLuint program = InitShader("vshader.glsl", "fshader.glsl");
-	glUseProgram(program);
-
-	// set up vertex arrays
-	GLuint vPosition = glGetAttribLocation(program, "vPosition");
-	glEnableVertexAttribArray(vPosition);
-	glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Retrieve transformation uniform variable locations
-	CamPos = glGetUniformLocation(program, "camPos");
-	CamRotation = glGetUniformLocation(program, "camRotation");
-	AspectRatio = glGetUniformLocation(program, "aspectRatio");
-	LightPos = glGetUniformLocation(program, "lightPos");
-	RotateMatrix = glGetUniformLocation(program, "rotateMatrix");
-	ViewDepthField = glGetUniformLocation(program, "viewDepthField");
-	LocalLights = glGetUniformLocation(program, "localLights");
+	// Build the shaders for the starting settings, other combinations compile when first used
+	useShaderVariant(&tiledShader);
+	useShaderVariant(&prepassShader);
+	useShaderVariant(&gbufferShader);
+	useShaderVariant(&shadowShader);
+	useShaderVariant(&resolveShader);
+	useShaderVariant(&fragmentShader);
+
+	// set up vertex arrays, vPosition is at location 0 in every variant
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// Create the uniform buffer every program reads its frame data from
+	glGenBuffers(1, &ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(struct frameUniforms), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
+	
+	// Create the compute path render target and frame timers
+	glGenFramebuffers(1, &frameFramebuffer);
+	glGenFramebuffers(1, &meshFramebuffer);
+	applyRenderScale();
+	initFrameTarget(screenWidth, screenHeight);
+	glGenQueries(2, timerQueries);
 	
 	initLocalLights();
 	
@@ -351,6 +936,34 @@ void initRender(){
 	}
 	initVoxels();
 	
+	//load voxels into GPU
+#if VOXEL_TEXTURE
+	glGenTextures(1, &voxelTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, voxelTexture);
+	glTexStorage3D(GL_TEXTURE_3D, LOD_LEVELS + 1, GL_R32I, VOXELS_WIDTH, VOXELS_HEIGHT, VOXELS_WIDTH);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glActiveTexture(GL_TEXTURE0);
+#else
+	glGenBuffers(1, &ssbo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(voxels) + LOD_VOXELS * sizeof(int), NULL, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo);
+#endif
+	initLod();
+	
+	initCompression();
+	initSunMap();
+	initHeightMap();
+	initOcclusion();
+	initProbes();
+	initMeshes();
+	initViews();
+	initCapture();
+	initGovernor();
+	updateGeometry();
+	
 	initThreadWork();
 	
 	//threaded depth field generation
@@ -362,28 +975,10 @@ void initRender(){
 		pthread_create(&genThread[i], NULL, computeDepthField, (void*)&threadData[i]);
 	}
 	
-	//load voxels into GPU
-	glGenBuffers(2, &ssbo);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(voxels), voxels, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo);
-	
 	glShadeModel(GL_FLAT);
 }
 
 
-void placeLocalLight(float x, float y, float z, float diffuse){
-	for (int i=0; i<MAX_LOCAL_LIGHTS; i++){
-		if (localLights[i].x < 0 || localLights[i].y < 0 || localLights[i].z < 0){
-			localLights[i].x = x;
-			localLights[i].y = y;
-			localLights[i].z = z;
-			localLights[i].a = diffuse;
-			break;
-		}
-	}
-}
-
 
 void lightUpdate(){
     float increment = 0.3f / fps;
@@ -397,7 +992,9 @@ void lightUpdate(){
     }
     lightRotation += increment;
     
-    rot = glm::rotate(rot, glm::radians(lightRotation), glm::vec3(0, 0, 1));
+    //change driven rendering only redraws for the sun once per step
+    float sunRotation = changeDriven ? glm::floor(lightRotation / SUN_STEP_DEGREES) * SUN_STEP_DEGREES : lightRotation;
+    rot = glm::rotate(rot, glm::radians(sunRotation), glm::vec3(0, 0, 1));
     lightPos = rot * glm::vec4(startLightPos, 1);
 }
 
@@ -407,5 +1004,10 @@ void reshape(int width, int height){
     screenWidth = width;
 
     aspectRatio = (float)width / height;
-    glUniform1f(AspectRatio, aspectRatio);
+    initFrameTarget(width, height);
+    applyRenderScale();
+    markSceneChanged();
+    
+    //the next frame draws before the main loop uploads again, it must see the new size and no history
+    updateUniforms();
 }
@@ -4,11 +4,54 @@
 #define VOXELS_WIDTH 512
 #define VOXELS_HEIGHT 96
 
+#define RENDER_DIST 384
 #define DEPTH_FIELD_RADIUS 7
 #define THREAD_COUNT 4
 
+//keep voxels in an R32I 3D texture read with texelFetch instead of the SSBO, passed on to every shader
+#define VOXEL_TEXTURE 0
+
+#define TILE_SIZE 8
+#define MIN_SHADOW_SCALE 2
+#define MAX_SHADOW_SCALE 4
+
+//render settings compiled into the shaders, each program is built once per combination it depends on
+#define SHADER_DEPTH_VIEW 1
+#define SHADER_DEPTH_PREPASS 2
+#define SHADER_BLOCK_LIGHT 4
+#define SHADER_STOCHASTIC_LIGHTS 8
+#define SHADER_NO_SHADOWS 16
+#define SHADER_EDGE_UPSCALE 32
+#define SHADER_CHECKERBOARD 64
+#define SHADER_FLAGS 7
+#define SHADER_VARIANTS (1 << SHADER_FLAGS)
+
+#define RENDER_FRAGMENT 0
+#define RENDER_TILED 1
+#define RENDER_DEFERRED 2
+#define RENDER_HYBRID 3
+#define RENDER_PATHS 4
+
+//dynamic resolution, off or rendering at a scale held to targetFrameTime and upscaled to the window
+#define UPSCALE_OFF 0
+#define UPSCALE_BILINEAR 1
+#define UPSCALE_EDGE 2
+#define UPSCALE_MODES 3
+#define MIN_RENDER_SCALE 0.5f
+#define RENDER_SCALE_STEPS 32
+#define RENDER_SCALE_KP 0.2f
+#define RENDER_SCALE_KI 0.05f
+
+//checkerboard frames are compared to a full trace on request, counting pixels with any channel off by more than this
+#define CHECKERBOARD_METRIC_THRESHOLD 8
+
+//change driven rendering draws nothing while the scene is unchanged, once the probe and sun map sweeps have caught up
+//the sun moves in steps of this many degrees so it only changes the scene now and then
+#define IDLE_SETTLE_FRAMES 96
+#define SUN_STEP_DEGREES 5.0f
+
 #define ENTITY_CHUNK_SIZE 32
-#define MAX_LOCAL_LIGHTS 16
+#define MAX_LOCAL_LIGHTS 4096
 
 extern const int NumVertices;
 
@@ -24,12 +67,41 @@ extern float aspectRatio;
 extern float lightRotation;
 
 extern int viewDepthField;
+extern int renderPath;
+extern int depthPrepass;
+extern int shadowScale;
+extern int stochasticLights;
+extern int blockLightMode;
+extern int shadows;
+extern int upscaleMode;
+extern int qualityGovernor;
+extern int checkerboard;
+extern int changeDriven;
+extern int viewThumbnails;
+extern float targetFrameTime;
+extern float gpuTime;
+extern float renderScale;
 
 extern bool* entityMap;
 
+//the programs of one shader for every combination of its SHADER_* flags, compiled on first use
+struct shaderVariants{
+	const char* vShaderFile; //NULL for compute shaders
+	const char* shaderFile;
+	int flags;
+	GLuint programs[SHADER_VARIANTS];
+};
+
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile, int flags = 0);
+GLuint InitComputeShader(const char* cShaderFile, int flags = 0);
+int getShaderFlags();
+GLuint useShaderVariant(struct shaderVariants* shader);
 void updateGeometry();
 void updatePartialGeometry(glm::vec3 start, glm::vec3 end);
+void uploadVoxelBox(glm::ivec3 start, glm::ivec3 end);
+void uploadVoxelLevelBox(int level, glm::ivec3 start, glm::ivec3 end, const int* levelVoxels);
 void initRender();
+void drawFrame();
 int getVoxelIndex(int x, int y, int z);
 void placeVoxel(int x, int y, int z, int voxel);
 void destroyVoxel(int x, int y, int z);
@@ -38,4 +110,7 @@ void lightUpdate();
 void updateUniforms();
 void removeSphere(glm::ivec3 pos, int radius);
 void reshape(int width, int height);
-void placeLocalLight(float x, float y, float z, float diffuse);
+void resetLightingHistory();
+void requestCheckerboardMetric();
+void markSceneChanged();
+int isSceneIdle();
@@ -0,0 +1,78 @@
+#version 430
+
+#include "raycast.glsl"
+#include "deferred.glsl"
+#include "reservoir.glsl"
+
+layout(local_size_x=8, local_size_y=8) in;
+
+#if STOCHASTIC_LIGHTS && !BLOCK_LIGHT
+//sun plus the one light the nearest shadow pixel's reservoir picked, so edges cost the same rays as the shadow pass
+float reservoirLightHit(vec3 pos, vec3 normal, ivec2 shadowPixel){
+	vec4 r=imageLoad(reservoirs, shadowPixel);
+	int light=floatBitsToInt(r.x);
+	float multiplier=ambientLight(pos, normal) + sunLight(pos, normal);
+	
+	if (light >= 0){
+		multiplier+=localLight(light, pos, normal) * r.y;
+	}
+	return min(multiplier, MAX_OVERBRIGHT);
+}
+#endif
+
+void main(){
+	ivec2 pixel=ivec2(gl_GlobalInvocationID.xy);
+	
+	//the G-buffer pass already wrote the step counts
+	if (!onScreen(pixel) || DEPTH_VIEW == 1){
+		return;
+	}
+	
+	ivec2 hit=imageLoad(gVoxel, pixel).xy;
+	vec4 fColor=SKY_COLOR;
+	
+	if (hit.x != -1){
+		vec3 pos=imageLoad(gPosition, pixel).xyz;
+		vec3 normal=decodeNormal(hit.y);
+		
+		//bilinear footprint of this pixel in the low resolution lighting
+		vec2 shadowPos=(vec2(pixel) - shadowScale / 2) / shadowScale;
+		ivec2 shadowBase=ivec2(floor(shadowPos));
+		vec2 blend=shadowPos - shadowBase;
+		
+		float multiplier=0.0f;
+		float weight=0.0f;
+		for (int i=0; i<4; i++){
+			ivec2 offset=ivec2(i & 1, i >> 1);
+			ivec2 shadowPixel=clamp(shadowBase + offset, ivec2(0, 0), getShadowSize() - 1);
+			ivec2 hitPixel=getShadowSamplePixel(shadowPixel);
+			ivec2 shadowHit=imageLoad(gVoxel, hitPixel).xy;
+			
+			//only blend samples that lie on the same plane as this pixel's voxel face
+			if (shadowHit.x != -1 && shadowHit.y == hit.y &&
+				abs(dot(normal, imageLoad(gPosition, hitPixel).xyz - pos)) < 0.01f){
+				
+				float shadowWeight=(offset.x == 1 ? blend.x : 1.0f - blend.x) * (offset.y == 1 ? blend.y : 1.0f - blend.y) + 0.001f;
+				multiplier+=imageLoad(shadowLight, shadowPixel).w * shadowWeight;
+				weight+=shadowWeight;
+			}
+		}
+		
+		if (weight > 0.0f){
+			multiplier/=weight;
+		}
+		//no sample shares this face, trace it at full rate so edges stay sharp
+		else{
+#if STOCHASTIC_LIGHTS && !BLOCK_LIGHT
+			ivec2 nearest=clamp(shadowBase + ivec2(greaterThanEqual(blend, vec2(0.5f, 0.5f))), ivec2(0, 0), getShadowSize() - 1);
+			multiplier=reservoirLightHit(pos, normal, nearest);
+#else
+			multiplier=lightHit(pos, normal);
+#endif
+		}
+		
+		fColor=voxelColor(readVoxel(hit.x), multiplier);
+	}
+	
+	imageStore(frame, pixel, fColor);
+}
@@ -0,0 +1,64 @@
+#include "sunmap.hpp"
+
+static GLuint sunMapProgram, sunMapBuffer;
+static GLint sunSlabLocation;
+
+//slabs touched by edits are refreshed before the sweep continues
+static char dirtySlabs[SUN_SLABS];
+static int sweepSlab = 0;
+static int sunMapReady = 0;
+
+void initSunMap(){
+	sunMapProgram = InitComputeShader("sunmap.glsl");
+	sunSlabLocation = glGetUniformLocation(sunMapProgram, "sunSlab");
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glGenBuffers(1, &sunMapBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sunMapBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, SUN_SLABS * SUN_SLAB_WORDS * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sunMapBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+}
+
+static void refreshSlab(int slab){
+	glUniform1i(sunSlabLocation, slab);
+	glDispatchCompute((SUN_SLAB_WORDS + 63) / 64, 1, 1);
+	dirtySlabs[slab] = 0;
+}
+
+void updateSunMap(){
+	glUseProgram(sunMapProgram);
+	
+	int refreshed = 0;
+	for (int i = 0; i < SUN_SLABS && refreshed < SUN_SLABS_PER_FRAME; i++){
+		if (dirtySlabs[i]){
+			refreshSlab(i);
+			refreshed++;
+		}
+	}
+	for (; refreshed < SUN_SLABS_PER_FRAME; refreshed++){
+		refreshSlab(sweepSlab);
+		
+		//the whole map has been traced once, lookups can replace shadow rays
+		if (++sweepSlab == SUN_SLABS){
+			sweepSlab = 0;
+			sunMapReady = 1;
+		}
+	}
+	
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void invalidateSunMap(glm::vec3 start, glm::vec3 end){
+	int startSlab = glm::max((int)glm::min(start.z, end.z) - SUN_EDIT_REACH, 0) / SUN_SLAB_DEPTH;
+	int endSlab = glm::min((int)glm::max(start.z, end.z) + SUN_EDIT_REACH, VOXELS_WIDTH - 1) / SUN_SLAB_DEPTH;
+	
+	for (int i = startSlab; i <= endSlab; i++){
+		dirtySlabs[i] = 1;
+	}
+}
+
+int isSunMapReady(){
+	return sunMapReady;
+}
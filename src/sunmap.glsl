@@ -0,0 +1,49 @@
+#version 430
+
+#include "raycast.glsl"
+
+//one invocation per word of sun visibility bits
+layout(local_size_x=64) in;
+
+//see sunmap.hpp
+const int SUN_SLAB_DEPTH=8;
+const int SUN_SLAB_WORDS=VOXELS_WIDTH * VOXELS_HEIGHT * SUN_SLAB_DEPTH / 32;
+
+uniform int sunSlab;
+
+bool isSolid(ivec3 voxel){
+	int index=getVoxelIndex(voxel);
+	return index >= 0 && readVoxel(voxel, 0, index) >= 0;
+}
+
+void main(){
+	lodRays=false;
+	
+	if (gl_GlobalInvocationID.x >= SUN_SLAB_WORDS){
+		return;
+	}
+	int word=sunSlab*SUN_SLAB_WORDS + int(gl_GlobalInvocationID.x);
+	uint bits=0;
+	
+	//only empty voxels next to a solid one can be in front of a hit
+	for (int i=0; i<32; i++){
+		int index=word*32 + i;
+		ivec3 voxel=ivec3(index % VOXELS_WIDTH, (index / VOXELS_WIDTH) % VOXELS_HEIGHT, index / (VOXELS_WIDTH * VOXELS_HEIGHT));
+		
+		if (readVoxel(voxel, 0, index) >= 0 ||
+			!(isSolid(voxel + ivec3(1, 0, 0)) || isSolid(voxel - ivec3(1, 0, 0)) ||
+			isSolid(voxel + ivec3(0, 1, 0)) || isSolid(voxel - ivec3(0, 1, 0)) ||
+			isSolid(voxel + ivec3(0, 0, 1)) || isSolid(voxel - ivec3(0, 0, 1)))){
+			
+			continue;
+		}
+		vec3 center=vec3(voxel) + 0.5f;
+		vec3 toLight=normalize(lightPos - center);
+		
+		if (castRay(center, toLight, RENDER_DIST) == -1){
+			bits|=1u << i;
+		}
+	}
+	
+	sunVisibility[word]=bits;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "render.hpp"
+
+//sun visibility is kept as one bit per voxel, refreshed a few z slabs per frame as the sun moves
+#define SUN_SLAB_DEPTH 8
+#define SUN_SLABS (VOXELS_WIDTH / SUN_SLAB_DEPTH)
+#define SUN_SLAB_WORDS (VOXELS_WIDTH * VOXELS_HEIGHT * SUN_SLAB_DEPTH / 32)
+#define SUN_SLABS_PER_FRAME 1
+
+//how far along z a shadow of an edit can land
+#define SUN_EDIT_REACH 32
+
+void initSunMap();
+void updateSunMap();
+void invalidateSunMap(glm::vec3 start, glm::vec3 end);
+int isSunMapReady();
@@ -0,0 +1,151 @@
+#version 430
+
+#include "raycast.glsl"
+
+//8x8 pixel tiles, see TILE_SIZE in render.hpp
+layout(local_size_x=8, local_size_y=8) in;
+
+layout(rgba8, binding=0) writeonly uniform image2D frame;
+
+#if CHECKERBOARD
+//hit position and distance of the traced half of the pixels, -1 for sky, read by checkerboard.glsl
+layout(rgba32f, binding=2) writeonly uniform image2D tracedPosition;
+#endif
+
+//bounds of everything the tile's primary rays hit, used to cull local lights once per tile
+shared int tileMinX;
+shared int tileMinY;
+shared int tileMinZ;
+shared int tileMaxX;
+shared int tileMaxY;
+shared int tileMaxZ;
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+
+//light grid cell every hit in the tile is in, or -1 when the tile spans several cells
+shared int tileCell;
+
+//lights of that cell that can reach any hit in the tile, one mask bit per bucket slot
+shared uint tileLightMask[LIGHTS_PER_CELL / 32];
+shared int tileLights[LIGHTS_PER_CELL];
+shared int tileLightCount;
+
+void main(){
+	ivec2 pixel=ivec2(gl_GlobalInvocationID.xy);
+	
+	//checkerboard frames trace alternating halves of the pixels, checkerboard.glsl fills in the rest,
+	//every thread takes one traced pixel of a 16x8 tile so no lane sits idle
+#if CHECKERBOARD
+	pixel.x=pixel.x * 2 + ((pixel.y + frameIndex) & 1);
+#endif
+	bool onScreen=pixel.x < int(screenSize.x) && pixel.y < int(screenSize.y);
+	
+	if (gl_LocalInvocationIndex == 0){
+		tileMinX=VOXELS_WIDTH;
+		tileMinY=VOXELS_HEIGHT;
+		tileMinZ=VOXELS_WIDTH;
+		tileMaxX=-1;
+		tileMaxY=-1;
+		tileMaxZ=-1;
+		tileMinDepth=floatBitsToUint(float(RENDER_DIST));
+		tileMaxDepth=0;
+	}
+	if (gl_LocalInvocationIndex < LIGHTS_PER_CELL / 32){
+		tileLightMask[gl_LocalInvocationIndex]=0;
+	}
+	barrier();
+	
+	int fColorIndex=-1;
+	if (onScreen){
+		fColorIndex=castPrimaryRay(pixel);
+	}
+	vec3 firstHitPos=hitPos;
+	vec3 firstHitNormal=hitNormal;
+	bool lit=fColorIndex != -1 && readVoxel(fColorIndex) >= 0 && DEPTH_VIEW == 0;
+	
+	if (lit){
+		//positive floats keep their order as uints
+		uint depth=floatBitsToUint(length(firstHitPos - camPos));
+		atomicMin(tileMinDepth, depth);
+		atomicMax(tileMaxDepth, depth);
+		
+		ivec3 hitVoxel=ivec3(floor(firstHitPos));
+		atomicMin(tileMinX, hitVoxel.x);
+		atomicMin(tileMinY, hitVoxel.y);
+		atomicMin(tileMinZ, hitVoxel.z);
+		atomicMax(tileMaxX, hitVoxel.x + 1);
+		atomicMax(tileMaxY, hitVoxel.y + 1);
+		atomicMax(tileMaxZ, hitVoxel.z + 1);
+	}
+	barrier();
+	
+	vec3 tileMin=vec3(tileMinX, tileMinY, tileMinZ);
+	vec3 tileMax=vec3(tileMaxX, tileMaxY, tileMaxZ);
+	int cell=getLightCell(tileMin);
+	bool oneCell=BLOCK_LIGHT == 0 && tileMaxX >= 0 && cell == getLightCell(tileMax - 1);
+	
+	//each thread tests a few slots of the shared cell's bucket against the tile bounds
+	for (int slot=int(gl_LocalInvocationIndex); oneCell && slot < cellLightCounts[cell]; slot+=TILE_SIZE*TILE_SIZE){
+		vec4 light=localLights[cellLights[cell*LIGHTS_PER_CELL + slot]];
+		float lightDepth=length(light.xyz - camPos);
+		
+		if (length(light.xyz - clamp(light.xyz, tileMin, tileMax)) <= lightDist &&
+			lightDepth >= uintBitsToFloat(tileMinDepth) - lightDist &&
+			lightDepth <= uintBitsToFloat(tileMaxDepth) + lightDist){
+			
+			atomicOr(tileLightMask[slot / 32], 1u << (slot % 32));
+		}
+	}
+	barrier();
+	
+	//compact into a list, keeping the light order the fragment path uses
+	if (gl_LocalInvocationIndex == 0){
+		tileLightCount=0;
+		tileCell=oneCell ? cell : -1;
+		for (int i=0; oneCell && i<cellLightCounts[cell]; i++){
+			if ((tileLightMask[i / 32] & (1u << (i % 32))) != 0){
+				tileLights[tileLightCount++]=cellLights[cell*LIGHTS_PER_CELL + i];
+			}
+		}
+	}
+	barrier();
+	
+	if (!onScreen){
+		return;
+	}
+	
+	vec4 fColor=SKY_COLOR;
+	
+#if DEPTH_VIEW
+	fColor=depthFieldColor();
+#endif
+	
+	//apply color of shortest ray
+	//hits spread over several cells look up their own cell, block light needs no culling,
+	//and tiles with more lights than maxLights rank the cell's lights per hit
+	if (lit && (tileCell == -1 || tileLightCount > maxLights)){
+		fColor=voxelColor(readVoxel(fColorIndex), lightHit(firstHitPos, firstHitNormal));
+	}
+	else if (lit){
+		float multiplier=ambientLight(firstHitPos, firstHitNormal) + sunLight(firstHitPos, firstHitNormal);
+		
+		//cast rays to the local lights left after tile culling
+		for (int i=0; i<tileLightCount; i++){
+			//ensure we don't make areas overbright
+			if (multiplier >= MAX_OVERBRIGHT){
+				multiplier=MAX_OVERBRIGHT;
+				break;
+			}
+			multiplier+=localLight(tileLights[i], firstHitPos, firstHitNormal);
+		}
+		
+		fColor=voxelColor(readVoxel(fColorIndex), min(multiplier, MAX_OVERBRIGHT));
+	}
+	
+	imageStore(frame, pixel, fColor);
+	
+#if CHECKERBOARD
+	bool hit=fColorIndex != -1 && readVoxel(fColorIndex) >= 0;
+	imageStore(tracedPosition, pixel, vec4(firstHitPos, hit ? length(firstHitPos - camPos) : -1.0f));
+#endif
+}
@@ -0,0 +1,112 @@
+#include "views.hpp"
+
+//one view as views.glsl reads it (std430), the tan of half the field of view rides in the position's w
+struct viewData{
+	glm::mat4 rotation;
+	glm::vec4 posFov;
+	glm::ivec4 viewport;
+	glm::ivec4 tiles; //first tile in the dispatch, then tiles per row
+};
+
+static struct shaderVariants viewShader = {NULL, "views.glsl", SHADER_BLOCK_LIGHT | SHADER_NO_SHADOWS};
+static GLuint viewBuffer;
+static GLuint atlasTexture, atlasFramebuffer;
+static int atlasWidth = 0, atlasHeight = 0;
+
+//large dispatches are folded into rows so no dimension runs past the workgroup count limit
+static const int DISPATCH_ROW = 256;
+
+void initViews(){
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glGenBuffers(1, &viewBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, viewBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_VIEWS * sizeof(struct viewData), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, viewBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+	
+	glGenFramebuffers(1, &atlasFramebuffer);
+}
+
+static void resizeAtlas(int width, int height){
+	glDeleteTextures(1, &atlasTexture);
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, atlasFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlasTexture, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	
+	atlasWidth = width;
+	atlasHeight = height;
+}
+
+//every view's 8x8 tiles follow each other in one dispatch, so the cost goes with the total pixels and not the view count,
+//the returned atlas is reused by the next call
+GLuint renderViews(const struct cameraView* views, int count, int width, int height){
+	struct viewData data[MAX_VIEWS];
+	int tileCount = 0;
+	
+	count = glm::min(count, MAX_VIEWS);
+	for (int i = 0; i < count; i++){
+		glm::ivec2 tiles = (glm::ivec2(views[i].viewport.z, views[i].viewport.w) + TILE_SIZE - 1) / TILE_SIZE;
+		
+		data[i].rotation = views[i].rotation;
+		data[i].posFov = glm::vec4(views[i].pos, glm::tan(glm::radians(views[i].fov) / 2.0f));
+		data[i].viewport = views[i].viewport;
+		data[i].tiles = glm::ivec4(tileCount, tiles.x, 0, 0);
+		tileCount += tiles.x * tiles.y;
+	}
+	
+	if (width != atlasWidth || height != atlasHeight){
+		resizeAtlas(width, height);
+	}
+	if (tileCount == 0){
+		return atlasTexture;
+	}
+	
+	GLint currentBuffer;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &currentBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, viewBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(struct viewData), data);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentBuffer);
+	
+	//the atlas takes the frame's image unit for the dispatch, the frame goes back after
+	GLint frameImage;
+	glGetIntegeri_v(GL_IMAGE_BINDING_NAME, 0, &frameImage);
+	glBindImageTexture(0, atlasTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	
+	//viewCount and tileCount are at locations 0 and 1
+	useShaderVariant(&viewShader);
+	glUniform1i(0, count);
+	glUniform1i(1, tileCount);
+	glDispatchCompute(glm::min(tileCount, DISPATCH_ROW), (tileCount + DISPATCH_ROW - 1) / DISPATCH_ROW, 1);
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	
+	glBindImageTexture(0, frameImage, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+	return atlasTexture;
+}
+
+//a minimap above the player and rear, left and right cameras, in a 2x2 atlas drawn in the window's top left corner
+void drawViewThumbnails(){
+	//the side cameras are level, the minimap looks straight down with forward at the top
+	glm::mat4 yaw = glm::rotate(glm::mat4(1.0f), camRotation.y, glm::vec3(0, 1, 0));
+	struct cameraView views[4] = {
+		{camPos + glm::vec3(0, 96, 0), glm::rotate(yaw, glm::radians(90.0f), glm::vec3(1, 0, 0)), 60.0f, glm::ivec4(0, THUMBNAIL_HEIGHT, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT)},
+		{camPos, glm::rotate(yaw, glm::radians(180.0f), glm::vec3(0, 1, 0)), 60.0f, glm::ivec4(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT)},
+		{camPos, glm::rotate(yaw, glm::radians(-90.0f), glm::vec3(0, 1, 0)), 60.0f, glm::ivec4(0, 0, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT)},
+		{camPos, glm::rotate(yaw, glm::radians(90.0f), glm::vec3(0, 1, 0)), 60.0f, glm::ivec4(THUMBNAIL_WIDTH, 0, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT)},
+	};
+	int width = THUMBNAIL_WIDTH * 2;
+	int height = THUMBNAIL_HEIGHT * 2;
+	
+	renderViews(views, 4, width, height);
+	
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, atlasFramebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, screenHeight - height, width, screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "render.hpp"
+
+//extra cameras are traced into one atlas texture in a single dispatch, sharing the world and lights with the main view
+#define MAX_VIEWS 64
+
+//size of each thumbnail viewThumbnails shows in the window's corner
+#define THUMBNAIL_WIDTH 192
+#define THUMBNAIL_HEIGHT 108
+
+struct cameraView{
+	glm::vec3 pos;
+	glm::mat4 rotation; //a camera rotation like rotateMatrix
+	float fov; //vertical, in degrees
+	glm::ivec4 viewport; //x, y, width and height in the atlas
+};
+
+void initViews();
+GLuint renderViews(const struct cameraView* views, int count, int atlasWidth, int atlasHeight);
+void drawViewThumbnails();
@@ -1,6 +1,6 @@
 #version 430
 
-in vec4 vPosition;
+layout(location=0) in vec4 vPosition;
 out vec4 vPos;
 
 void main(){
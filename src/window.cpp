@@ -1,18 +1,49 @@
+#include <stdio.h>
 #include <time.h>
+#include <string.h>
+#include <fstream>
 
 #include "window.hpp"
 #include "render.hpp"
+#include "controls.hpp"
+#include "capture.hpp"
 
 static char* title;
+static const char* renderPathNames[RENDER_PATHS] = {"fragment", "tiled", "deferred", "hybrid"};
+static const char* upscaleNames[UPSCALE_MODES] = {"", "bilinear", "edge aware"};
 static clock_t start;
 static GLFWwindow* window;
 
+//when the oldest input not yet on screen was seen (-1 for none), when input was last sampled for a frame,
+//and what the last frame with input took from that input to its present
+static double inputTime = -1.0;
+static double sampleTime;
+static float inputLatency = 0.0f;
+
+//the frame limiter's next present and how long recent frames took from sampling to present
+static double nextPresent = 0.0;
+static double frameWork = 0.0;
+
+static std::ofstream latencyLog;
+static int presentedFrames = 0;
+
+//input callbacks run inside the event polls, so this is the poll that first saw the input
+static void markInput(){
+	if (inputTime < 0.0){
+		inputTime = glfwGetTime();
+	}
+}
+
 static void mouse(GLFWwindow* window, double x, double y);
 static void scroll(GLFWwindow* window, double xoffset, double yoffset);
 static void mouseControl(GLFWwindow* window, int key, int action, int mods);
 static void buttons(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 static void mouse(GLFWwindow* window, double x, double y){ //update mouse
+	//the cursor only turns the camera while held, other moves never reach the screen
+	if (keys[LMB]){
+		markInput();
+	}
 	mouseX = x;
 	mouseY = y;
 }
@@ -27,6 +58,8 @@ static void scroll(GLFWwindow* window, double xoffset, double yoffset){ //zoom
 }
 
 static void mouseControl(GLFWwindow* window, int key, int action, int mods){
+	markInput();
+	markSceneChanged();
 	switch(key){
 		case GLFW_MOUSE_BUTTON_LEFT:
 			if (action == GLFW_PRESS){
@@ -48,6 +81,9 @@ static void mouseControl(GLFWwindow* window, int key, int action, int mods){
 }
 
 static void buttons(GLFWwindow* window, int key, int scancode, int action, int mods){
+	//any key may change a setting, frames are drawn until it has settled
+	markInput();
+	markSceneChanged();
 	switch (key){
 		case GLFW_KEY_SPACE:
 			if (action == GLFW_PRESS){
@@ -103,6 +139,177 @@ static void buttons(GLFWwindow* window, int key, int scancode, int action, int m
 			}
 			break;
 		
+		case GLFW_KEY_C:
+			if (action == GLFW_PRESS){
+				keys[KEY_C]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_C]=false;
+			}
+			break;
+		
+		case GLFW_KEY_P:
+			if (action == GLFW_PRESS){
+				keys[KEY_P]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_P]=false;
+			}
+			break;
+		
+		case GLFW_KEY_R:
+			if (action == GLFW_PRESS){
+				keys[KEY_R]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_R]=false;
+			}
+			break;
+		
+		case GLFW_KEY_L:
+			if (action == GLFW_PRESS){
+				keys[KEY_L]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_L]=false;
+			}
+			break;
+		
+		case GLFW_KEY_B:
+			if (action == GLFW_PRESS){
+				keys[KEY_B]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_B]=false;
+			}
+			break;
+		
+		case GLFW_KEY_O:
+			if (action == GLFW_PRESS){
+				keys[KEY_O]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_O]=false;
+			}
+			break;
+		
+		case GLFW_KEY_V:
+			if (action == GLFW_PRESS){
+				keys[KEY_V]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_V]=false;
+			}
+			break;
+		
+		case GLFW_KEY_Q:
+			if (action == GLFW_PRESS){
+				keys[KEY_Q]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_Q]=false;
+			}
+			break;
+		
+		case GLFW_KEY_K:
+			if (action == GLFW_PRESS){
+				keys[KEY_K]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_K]=false;
+			}
+			break;
+		
+		case GLFW_KEY_M:
+			if (action == GLFW_PRESS){
+				keys[KEY_M]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_M]=false;
+			}
+			break;
+		
+		case GLFW_KEY_I:
+			if (action == GLFW_PRESS){
+				keys[KEY_I]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_I]=false;
+			}
+			break;
+		
+		case GLFW_KEY_F:
+			if (action == GLFW_PRESS){
+				keys[KEY_F]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_F]=false;
+			}
+			break;
+		
+		case GLFW_KEY_X:
+			if (action == GLFW_PRESS){
+				keys[KEY_X]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_X]=false;
+			}
+			break;
+		
+		case GLFW_KEY_Z:
+			if (action == GLFW_PRESS){
+				keys[KEY_Z]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_Z]=false;
+			}
+			break;
+		
+		case GLFW_KEY_H:
+			if (action == GLFW_PRESS){
+				keys[KEY_H]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_H]=false;
+			}
+			break;
+		
+		case GLFW_KEY_J:
+			if (action == GLFW_PRESS){
+				keys[KEY_J]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_J]=false;
+			}
+			break;
+		
+		case GLFW_KEY_Y:
+			if (action == GLFW_PRESS){
+				keys[KEY_Y]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_Y]=false;
+			}
+			break;
+		
+		case GLFW_KEY_N:
+			if (action == GLFW_PRESS){
+				keys[KEY_N]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_N]=false;
+			}
+			break;
+		
+		case GLFW_KEY_G:
+			if (action == GLFW_PRESS){
+				keys[KEY_G]=true;
+			}
+			else if (action == GLFW_RELEASE){
+				keys[KEY_G]=false;
+			}
+			break;
+		
 		case GLFW_KEY_LEFT_SHIFT:
 			if (action == GLFW_PRESS){
 				keys[SHIFT]=true;
@@ -127,6 +334,10 @@ void resize(GLFWwindow* win, int x, int y){
 	reshape(x, y);
 }
 
+void refresh(GLFWwindow* win){
+	markSceneChanged();
+}
+
 int startWindow(char* winTitle){
 	title = winTitle;
 	start = clock();
@@ -152,6 +363,7 @@ int startWindow(char* winTitle){
 	glfwSetScrollCallback(window, scroll);
 	glfwSetMouseButtonCallback(window, mouseControl);
 	glfwSetFramebufferSizeCallback(window, resize);
+	glfwSetWindowRefreshCallback(window, refresh);
 	glfwSwapInterval(vsync);
 	
 	return 0;
@@ -163,16 +375,70 @@ bool windowLoop(){
 		frames++;
 		fps = CLOCKS_PER_SEC/((double)(clock()-start));
 		start = clock();
-		/*
 		if (frames > fps){
-			char out[128];
-			sprintf(out, "%s FPS: %I64d", title, fps); //convert to chars
+			char out[256];
+			sprintf(out, "%s FPS: %I64d GPU: %.2fms Input: %.1fms (%s%s%s%s%s%s%s%s%s%s%s)", title, fps, gpuTime, inputLatency, renderPathNames[renderPath], checkerboard && renderPath == RENDER_TILED ? " + checkerboard" : "", depthPrepass ? " + prepass" : "", stochasticLights ? " + stochastic lights" : "", blockLightMode ? " + block light" : "", shadows ? "" : " + no shadows", qualityGovernor ? " + governor" : "", changeDriven ? " + change driven" : "", spectator ? " + spectator" : "", recording ? " + recording" : "", frameLimiter ? " + frame limiter" : ""); //convert to chars
+			if (upscaleMode != UPSCALE_OFF){
+				sprintf(out + strlen(out) - 1, " + %d%% %s)", (int)(renderScale * 100.0f + 0.5f), upscaleNames[upscaleMode]);
+			}
 			glfwSetWindowTitle(window, out);
 			frames=0;
 		}
-		*/
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		
+		//the limiter sleeps through the start of the frame so input is sampled as late as the frame allows,
+		//events arriving meanwhile are still handled
+		if (frameLimiter){
+			double wake = nextPresent - frameWork - LIMITER_MARGIN;
+			double now;
+			
+			while ((now = glfwGetTime()) < wake){
+				glfwWaitEventsTimeout(wake - now);
+			}
+		}
+		
+		//an idle scene presents nothing new, sleep until input or the sun's next step instead of spinning
+		//input that left the scene idle was never drawn, so it does not time the next frame
+		if (isSceneIdle()){
+			inputTime = -1.0;
+			glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+		}
+		else{
+			glfwPollEvents();
+		}
+		sampleTime = glfwGetTime();
 	}
 	return !glfwWindowShouldClose(window);
 }
+
+//presents a drawn frame, timing it from the input it was drawn with
+void presentFrame(){
+	if (!frameDrawn){
+		return;
+	}
+	glfwSwapBuffers(window);
+	frameDrawn = 0;
+	
+	double now = glfwGetTime();
+	float latency = -1.0f;
+	
+	if (inputTime >= 0.0){
+		latency = inputLatency = (now - inputTime) * 1000.0;
+		inputTime = -1.0;
+	}
+	
+	//a slow frame is expected again for a while, a missed present moves the next one on from now
+	frameWork = glm::max(now - sampleTime, frameWork * LIMITER_DECAY);
+	nextPresent = glm::max(nextPresent, now) + targetFrameTime / 1000.0;
+	
+	if (latencyLogging){
+		if (!latencyLog.is_open()){
+			latencyLog.open(LATENCY_LOG);
+			latencyLog << "frame,sample to present ms,input to present ms" << std::endl;
+		}
+		latencyLog << presentedFrames << "," << (now - sampleTime) * 1000.0 << "," << latency << std::endl;
+	}
+	else if (latencyLog.is_open()){
+		latencyLog.close();
+	}
+	presentedFrames++;
+}
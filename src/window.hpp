@@ -5,7 +5,7 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-#define KEYS 9
+#define KEYS 28
 
 #define KEY_W 0
 #define KEY_S 1
@@ -16,6 +16,36 @@
 #define SHIFT 6
 #define LMB 7
 #define RMB 8
+#define KEY_C 9
+#define KEY_P 10
+#define KEY_G 11
+#define KEY_R 12
+#define KEY_L 13
+#define KEY_B 14
+#define KEY_O 15
+#define KEY_V 16
+#define KEY_Q 17
+#define KEY_K 18
+#define KEY_M 19
+#define KEY_I 20
+#define KEY_F 21
+#define KEY_N 22
+#define KEY_X 23
+#define KEY_Z 24
+#define KEY_H 25
+#define KEY_J 26
+#define KEY_Y 27
+
+//longest an idle scene waits for events before checking on the sun and lights again
+#define IDLE_WAIT_SECONDS 0.1
+
+//the frame limiter wakes this long before the next present is due on top of the time recent frames took,
+//which forgets a slow frame at this rate per frame
+#define LIMITER_MARGIN 0.001
+#define LIMITER_DECAY 0.95
+
+//per frame timings written while latencyLogging is on, -1 for frames without new input
+#define LATENCY_LOG "latency.csv"
 
 extern int frames;
 extern long long fps;
@@ -26,6 +56,10 @@ extern int screenWidth;
 extern int fullscreen;
 extern int vsync;
 extern bool keys[KEYS];
+extern int frameDrawn;
+extern int frameLimiter;
+extern int latencyLogging;
 
 int startWindow(char* winTitle);
 bool windowLoop();
+void presentFrame();